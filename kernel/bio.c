@@ -1,10 +1,20 @@
 // Buffer cache.
 //
-// The buffer cache is a linked list of buf structures holding
+// The buffer cache is a hash table of buf structures holding
 // cached copies of disk block contents.  Caching disk blocks
 // in memory reduces the number of disk reads and also provides
 // a synchronization point for disk blocks used by multiple processes.
 //
+// Each hash bucket has its own lock, so lookups of different
+// blocks do not contend. A miss takes bcache.lock as well, to
+// choose a victim: the unused buf released longest ago, found by
+// comparing the tick of each buf's last release.
+//
+// Besides the NBUF static buffers, the cache borrows pages from
+// kalloc() for more while memory is plentiful, up to
+// BCACHE_MAXPAGES, and kalloc() takes them back with bshrink()
+// before it takes pages from processes.
+//
 // Interface:
 // * To get a buffer for a particular disk block, call bread.
 // * After changing buffer data, call bwrite to write it to disk.
@@ -22,70 +32,299 @@
 #include "defs.h"
 #include "fs.h"
 #include "buf.h"
+#include "memstat.h"
 
-struct {
+struct bucket {
   struct spinlock lock;
-  struct buf buf[NBUF];
+  struct buf head;      // bufs hashing here, through prev/next
+};
+
+// A page of buffers borrowed from kalloc().
+#define BUFPERPAGE ((PGSIZE - sizeof(struct bufpage *)) / sizeof(struct buf))
+struct bufpage {
+  struct bufpage *next;
+  struct buf buf[BUFPERPAGE];
+};
 
-  // Linked list of all buffers, through prev/next.
-  // Sorted by how recently the buffer was used.
-  // head.next is most recent, head.prev is least.
-  struct buf head;
+struct {
+  struct spinlock lock; // serializes evictions, growing and shrinking
+  struct buf buf[NBUF];
+  struct bucket bucket[NBUFBUCKET];
+  struct bufpage *pages; // borrowed pages
+  int npages;
+  int nahead;            // buffers held by readahead in flight
 } bcache;
 
+static struct bucket*
+bucketof(uint dev, uint blockno)
+{
+  return &bcache.bucket[(dev * 31 + blockno) % NBUFBUCKET];
+}
+
+static void bput(struct buf *b);
+
+static void
+bucket_insert(struct bucket *bk, struct buf *b)
+{
+  b->next = bk->head.next;
+  b->prev = &bk->head;
+  bk->head.next->prev = b;
+  bk->head.next = b;
+}
+
+static void
+bucket_remove(struct buf *b)
+{
+  b->next->prev = b->prev;
+  b->prev->next = b->next;
+}
+
+// Return the buf caching (dev, blockno) in bk, or 0.
+// Caller must hold bk->lock.
+static struct buf*
+bucket_find(struct bucket *bk, uint dev, uint blockno)
+{
+  struct buf *b;
+
+  for(b = bk->head.next; b != &bk->head; b = b->next)
+    if(b->dev == dev && b->blockno == blockno)
+      return b;
+  return 0;
+}
+
 void
 binit(void)
 {
   struct buf *b;
+  struct bucket *bk;
 
   initlock(&bcache.lock, "bcache");
+  for(bk = bcache.bucket; bk < bcache.bucket+NBUFBUCKET; bk++){
+    initlock(&bk->lock, "bcache.bucket");
+    bk->head.prev = &bk->head;
+    bk->head.next = &bk->head;
+  }
 
-  // Create linked list of buffers
-  bcache.head.prev = &bcache.head;
-  bcache.head.next = &bcache.head;
+  // All buffers start out caching block 0 of device 0,
+  // which is never asked for.
+  bk = bucketof(0, 0);
   for(b = bcache.buf; b < bcache.buf+NBUF; b++){
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
     initsleeplock(&b->lock, "buffer");
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
+    bucket_insert(bk, b);
+  }
+}
+
+// Take an unused buf off its bucket to recycle it: the one
+// released longest ago. Returns 0 if all are in use.
+// Caller must hold bcache.lock, which lets it hold several bucket
+// locks at once; everyone else holds at most one.
+static struct buf*
+bvictim(void)
+{
+  struct bucket *bk, *held = 0;
+  struct buf *b, *victim = 0;
+
+  for(bk = bcache.bucket; bk < bcache.bucket+NBUFBUCKET; bk++){
+    int found = 0;
+    acquire(&bk->lock);
+    for(b = bk->head.next; b != &bk->head; b = b->next){
+      if(b->refcnt == 0 && (victim == 0 || b->lastuse < victim->lastuse)){
+        victim = b;
+        found = 1;
+      }
+    }
+    if(found){
+      // keep the victim's bucket locked so it stays unused.
+      if(held)
+        release(&held->lock);
+      held = bk;
+    } else {
+      release(&bk->lock);
+    }
+  }
+  if(victim){
+    bucket_remove(victim);
+    if(victim->ra)
+      vmstat_add(VM_RA_MISS, 1);
+    release(&held->lock);
+  }
+  return victim;
+}
+
+// Borrow a page from kalloc() for BUFPERPAGE more buffers: only
+// while more than a quarter of memory is free, unless force is
+// set. Returns 1 if the cache grew. Caller must hold bcache.lock.
+static int
+bgrow(int force)
+{
+  struct bufpage *pg;
+  struct bucket *bk = bucketof(0, 0);
+  uint64 total, nfree;
+
+  if(bcache.npages >= BCACHE_MAXPAGES)
+    return 0;
+  kmemstat(&total, &nfree);
+  if(!force && nfree <= total / 4)
+    return 0;
+  if((pg = kalloc_noreclaim()) == 0)
+    return 0;
+  memset(pg, 0, sizeof(*pg));
+  acquire(&bk->lock);
+  for(struct buf *b = pg->buf; b < pg->buf+BUFPERPAGE; b++){
+    initsleeplock(&b->lock, "buffer");
+    bucket_insert(bk, b);
+  }
+  release(&bk->lock);
+  pg->next = bcache.pages;
+  bcache.pages = pg;
+  bcache.npages++;
+  return 1;
+}
+
+// Take all the buffers of pg off their buckets, if none is in use.
+// Returns 1 if so; otherwise leaves them cached.
+// Caller must hold bcache.lock, so no buffer changes blocks.
+static int
+bdetach(struct bufpage *pg)
+{
+  struct bucket *bk;
+  int i, j;
+
+  for(i = 0; i < BUFPERPAGE; i++){
+    bk = bucketof(pg->buf[i].dev, pg->buf[i].blockno);
+    acquire(&bk->lock);
+    if(pg->buf[i].refcnt != 0){
+      release(&bk->lock);
+      break;
+    }
+    bucket_remove(&pg->buf[i]);
+    release(&bk->lock);
+  }
+  if(i == BUFPERPAGE)
+    return 1;
+
+  // bget() misses on the detached ones meanwhile wait for
+  // bcache.lock and look again, so they cannot be duplicated.
+  for(j = 0; j < i; j++){
+    bk = bucketof(pg->buf[j].dev, pg->buf[j].blockno);
+    acquire(&bk->lock);
+    bucket_insert(bk, &pg->buf[j]);
+    release(&bk->lock);
+  }
+  return 0;
+}
+
+// Give a borrowed page of unused buffers back to kalloc().
+// Returns 1 if a page was freed, 0 if none could be.
+int
+bshrink(void)
+{
+  struct bufpage *pg, **pp;
+
+  acquire(&bcache.lock);
+  for(pp = &bcache.pages; (pg = *pp) != 0; pp = &pg->next){
+    if(bdetach(pg)){
+      *pp = pg->next;
+      bcache.npages--;
+      release(&bcache.lock);
+      kfree(pg);
+      return 1;
+    }
+  }
+  release(&bcache.lock);
+  return 0;
+}
+
+// Count a lookup that found b cached. Caller must hold b's bucket lock.
+static void
+bhit(struct buf *b)
+{
+  vmstat_add(VM_BCACHE_HIT, 1);
+  if(b->ra){
+    b->ra = 0;
+    vmstat_add(VM_RA_HIT, 1);
   }
 }
 
 // Look through buffer cache for block on device dev.
 // If not found, allocate a buffer.
 // In either case, return locked buffer.
+// For readahead (ahead set), return 0 instead if the block is
+// already cached, or if caching it would crowd out other blocks.
 static struct buf*
-bget(uint dev, uint blockno)
+bget(uint dev, uint blockno, int ahead)
 {
+  struct bucket *bk = bucketof(dev, blockno);
   struct buf *b;
 
-  acquire(&bcache.lock);
+  acquire(&bk->lock);
 
   // Is the block already cached?
-  for(b = bcache.head.next; b != &bcache.head; b = b->next){
-    if(b->dev == dev && b->blockno == blockno){
-      b->refcnt++;
+  if((b = bucket_find(bk, dev, blockno)) != 0){
+    if(ahead){
+      release(&bk->lock);
+      return 0;
+    }
+    b->refcnt++;
+    bhit(b);
+    release(&bk->lock);
+    acquiresleep(&b->lock);
+    return b;
+  }
+  release(&bk->lock);
+
+  // Not cached. Only one process at a time may recycle a
+  // buffer, so look again in case another one just did so
+  // for this block.
+  acquire(&bcache.lock);
+  acquire(&bk->lock);
+  if((b = bucket_find(bk, dev, blockno)) != 0){
+    if(ahead){
+      release(&bk->lock);
       release(&bcache.lock);
-      acquiresleep(&b->lock);
-      return b;
+      return 0;
     }
+    b->refcnt++;
+    bhit(b);
+    release(&bk->lock);
+    release(&bcache.lock);
+    acquiresleep(&b->lock);
+    return b;
   }
+  release(&bk->lock);
 
-  // Not cached.
-  // Recycle the least recently used (LRU) unused buffer.
-  for(b = bcache.head.prev; b != &bcache.head; b = b->prev){
-    if(b->refcnt == 0) {
-      b->dev = dev;
-      b->blockno = blockno;
-      b->valid = 0;
-      b->refcnt = 1;
+  // Readahead may hold at most half of the buffers.
+  if(ahead && bcache.nahead >= (NBUF + bcache.npages * BUFPERPAGE) / 2){
+    release(&bcache.lock);
+    return 0;
+  }
+
+  // Grow into free memory if there is plenty of it, else recycle
+  // the least recently used (LRU) unused buffer; grow anyway
+  // if every buffer is in use, unless this is only readahead.
+  bgrow(0);
+  if((b = bvictim()) == 0){
+    if(ahead){
       release(&bcache.lock);
-      acquiresleep(&b->lock);
-      return b;
+      return 0;
     }
+    if(bgrow(1) == 0 || (b = bvictim()) == 0)
+      panic("bget: no buffers");
   }
-  panic("bget: no buffers");
+  b->dev = dev;
+  b->blockno = blockno;
+  b->valid = 0;
+  b->refcnt = 1;
+  b->ra = ahead;
+  if(ahead)
+    __sync_fetch_and_add(&bcache.nahead, 1);
+  acquire(&bk->lock);
+  bucket_insert(bk, b);
+  release(&bk->lock);
+  release(&bcache.lock);
+  vmstat_add(VM_BCACHE_MISS, 1);
+  acquiresleep(&b->lock);
+  return b;
 }
 
 // Return a locked buf with the contents of the indicated block.
@@ -94,7 +333,7 @@ bread(uint dev, uint blockno)
 {
   struct buf *b;
 
-  b = bget(dev, blockno);
+  b = bget(dev, blockno, 0);
   if(!b->valid) {
     virtio_disk_rw(b, 0);
     b->valid = 1;
@@ -102,6 +341,87 @@ bread(uint dev, uint blockno)
   return b;
 }
 
+// Return a locked buf for a block that the caller is about to
+// overwrite entirely, without reading its old contents from disk.
+struct buf*
+bgrab(uint dev, uint blockno)
+{
+  struct buf *b;
+
+  b = bget(dev, blockno, 0);
+  b->valid = 1;
+  return b;
+}
+
+// Return locked bufs bp[0..n-1] for the n adjacent blocks starting
+// at blockno. Runs of blocks that are not cached are read with one
+// disk request each. Callers that hold several bufs at once must
+// take them in ascending block order, as this does, to avoid
+// deadlocking with each other.
+void
+bread_run(uint dev, uint blockno, int n, struct buf **bp)
+{
+  int i, j;
+
+  if(n < 1 || n > SGBLOCKS)
+    panic("bread_run");
+  for(i = 0; i < n; i++)
+    bp[i] = bget(dev, blockno + i, 0);
+  for(i = 0; i < n; i = j){
+    for(j = i; j < n && !bp[j]->valid; j++)
+      ;
+    if(j > i)
+      virtio_disk_submit(bp + i, j - i, 0);
+    else
+      j++;
+  }
+  for(i = 0; i < n; i++){
+    if(!bp[i]->valid){
+      virtio_disk_wait(bp[i]);
+      bp[i]->valid = 1;
+    }
+  }
+}
+
+// Start reading the n adjacent blocks from blockno into the cache
+// without waiting for them, as few disk requests as possible.
+// Blocks already cached are skipped. The disk interrupt marks each
+// buffer valid and releases it, see breadahead_done().
+void
+breadahead(uint dev, uint blockno, int n)
+{
+  struct buf *b, *bp[SGBLOCKS];
+  int i, m = 0, issued = 0;
+
+  for(i = 0; i <= n; i++){
+    b = i < n ? bget(dev, blockno + i, 1) : 0;
+    if(b){
+      b->async = 1;
+      bp[m++] = b;
+    }
+    if(m > 0 && (b == 0 || m == SGBLOCKS)){
+      virtio_disk_submit(bp, m, 0);
+      issued += m;
+      m = 0;
+    }
+  }
+  if(issued){
+    vmstat_add(VM_READAHEAD, issued);
+    virtio_disk_kick();
+  }
+}
+
+// Called by virtio_disk_intr() when a read started by
+// breadahead() has finished.
+void
+breadahead_done(struct buf *b)
+{
+  b->valid = 1;
+  __sync_fetch_and_sub(&bcache.nahead, 1);
+  releasesleep(&b->lock);
+  bput(b);
+}
+
 // Write b's contents to disk.  Must be locked.
 void
 bwrite(struct buf *b)
@@ -111,8 +431,49 @@ bwrite(struct buf *b)
   virtio_disk_rw(b, 1);
 }
 
+// Start writing b's contents to disk without waiting for it.
+// Must be locked, and stay locked until bwait(b) returns.
+void
+bwrite_start(struct buf *b)
+{
+  bwrite_run_start(&b, 1);
+}
+
+// Start writing the locked bufs bp[0..n-1], which hold adjacent
+// blocks, to disk as one request; bwait() on each of them.
+void
+bwrite_run_start(struct buf **bp, int n)
+{
+  for(int i = 0; i < n; i++)
+    if(!holdingsleep(&bp[i]->lock))
+      panic("bwrite_run_start");
+  virtio_disk_submit(bp, n, 1);
+}
+
+// Wait for the write started by bwrite_start(b) to finish.
+void
+bwait(struct buf *b)
+{
+  virtio_disk_wait(b);
+}
+
+// Drop a reference to b, stamping it with the time
+// of release for bvictim() if it was the last.
+static void
+bput(struct buf *b)
+{
+  struct bucket *bk = bucketof(b->dev, b->blockno);
+
+  acquire(&bk->lock);
+  b->refcnt--;
+  if (b->refcnt == 0) {
+    // no one is waiting for it.
+    b->lastuse = ticks;
+  }
+  release(&bk->lock);
+}
+
 // Release a locked buffer.
-// Move to the head of the most-recently-used list.
 void
 brelse(struct buf *b)
 {
@@ -120,34 +481,21 @@ brelse(struct buf *b)
     panic("brelse");
 
   releasesleep(&b->lock);
-
-  acquire(&bcache.lock);
-  b->refcnt--;
-  if (b->refcnt == 0) {
-    // no one is waiting for it.
-    b->next->prev = b->prev;
-    b->prev->next = b->next;
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
-  }
-  
-  release(&bcache.lock);
+  bput(b);
 }
 
 void
 bpin(struct buf *b) {
-  acquire(&bcache.lock);
+  struct bucket *bk = bucketof(b->dev, b->blockno);
+
+  acquire(&bk->lock);
   b->refcnt++;
-  release(&bcache.lock);
+  release(&bk->lock);
 }
 
 void
 bunpin(struct buf *b) {
-  acquire(&bcache.lock);
-  b->refcnt--;
-  release(&bcache.lock);
+  bput(b);
 }
 
 
@@ -1,11 +1,14 @@
 struct buf {
   int valid;   // has data been read from disk?
   int disk;    // does disk "own" buf?
+  int async;   // read ahead: disk interrupt releases it when done
+  int ra;      // read ahead, and not asked for since
   uint dev;
   uint blockno;
   struct sleeplock lock;
   uint refcnt;
-  struct buf *prev; // LRU cache list
+  uint lastuse;     // ticks at last release, for LRU recycling
+  struct buf *prev; // hash bucket list
   struct buf *next;
   uchar data[BSIZE];
 };
@@ -8,13 +8,28 @@ struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct thrash_stat;
+struct fault_stat;
+struct vm_stat;
+struct lock_stat;
+struct sched_info;
+struct pgwalk;
+struct tlbbatch;
 
 // bio.c
 void            binit(void);
 struct buf*     bread(uint, uint);
+struct buf*     bgrab(uint, uint);
 void            brelse(struct buf*);
 void            bwrite(struct buf*);
+void            bread_run(uint, uint, int, struct buf**);
+void            breadahead(uint, uint, int);
+void            breadahead_done(struct buf*);
+void            bwrite_start(struct buf*);
+void            bwrite_run_start(struct buf**, int);
+void            bwait(struct buf*);
 void            bpin(struct buf*);
+int             bshrink(void);
 void            bunpin(struct buf*);
 
 // console.c
@@ -50,22 +65,29 @@ int             namecmp(const char*, const char*);
 struct inode*   namei(char*);
 struct inode*   nameiparent(char*, char*);
 int             readi(struct inode*, int, uint64, uint, uint);
+void            readi_ahead(struct inode*, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, int, uint64, uint, uint);
+int             writei_direct(struct inode*, uint64, uint, uint);
 void            itrunc(struct inode*);
 void            ireclaim(int);
 struct inode*   create(char*, short, short, short);
 
 // kalloc.c
 void*           kalloc(void);
+void*           kalloc_noreclaim(void);
 void            kfree(void *);
 void            kinit(void);
+void            kmemstat(uint64*, uint64*);
 
 // log.c
 void            initlog(int, struct superblock*);
 void            log_write(struct buf*);
+void            log_wait_install(uint);
 void            begin_op(void);
 void            end_op(void);
+int             log_reserve(void);
+void            log_unreserve(void);
 
 // pipe.c
 int             pipealloc(struct file**, struct file**);
@@ -98,16 +120,60 @@ void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             kwait(uint64);
 void            wakeup(void*);
+void            wakeup_one(void*);
 void            yield(void);
+void            make_runnable(struct proc*);
+int             mlfq_tick(struct proc*);
+void            mlfq_boost(void);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
 void            procdump(void);
-void            add_to_resident_set(struct proc*, uint64, int);
+void            add_to_resident_set(struct proc*, uint64, int, int);
 void            remove_from_resident_set(struct proc*, uint64);
 int             do_page_replacement(struct proc*);
 int             swap_slot_alloc(struct proc*);
 void            swap_slot_free(struct proc*, int);
 int             find_seq_in_resident_set(struct proc*, uint64);
+int             find_slot_in_resident_set(struct proc*, uint64);
+void            free_resident_set(struct proc*);
+int             swap_write_page(struct proc*, int, uint64);
+int             swap_read_page(struct proc*, int, uint64);
+uint64          swapin_page(struct proc*, uint64);
+int             swapout_proc(struct proc*);
+void            swapin_proc(struct proc*);
+void            swapin_prefetch(struct proc*);
+int             swapout_idle(void);
+void            loadctl_fault(int);
+void            loadctl_tick(void);
+void            loadctl_suspend(void);
+void            loadctl_stat(struct thrash_stat*);
+void            faultlat_record(struct proc*, int, uint64);
+int             faultlat_stat(int, struct fault_stat*);
+void            vmstat_add(int, uint64);
+void            vmstat_get(struct vm_stat*);
+int             schedinfo(struct sched_info*, int);
+
+// tlb.c
+void            tlb_ipi(void);
+void            tlb_batch_init(struct tlbbatch*, struct proc*);
+void            tlb_batch_add(struct tlbbatch*, uint64);
+void            tlb_batch_free(struct tlbbatch*, uint64);
+void            tlb_batch_flush(struct tlbbatch*);
+void            tlb_flush_page(struct proc*, uint64);
+
+// prof.c
+void            profinit(void);
+void            prof_tick(void);
+void            profstart(void);
+int             profstop(void);
+int             profread(uint64, int);
+
+// pgtrace.c
+void            pgtraceinit(void);
+void            pgtrace_tick(struct proc*);
+int             pgtrace_start(int, int);
+void            pgtrace_exit(struct proc*);
+int             pgtrace_read(uint64, int);
 
 // swtch.S
 void            swtch(struct context*, struct context*);
@@ -119,6 +185,7 @@ void            initlock(struct spinlock*, char*);
 void            release(struct spinlock*);
 void            push_off(void);
 void            pop_off(void);
+int             lockstat_get(struct lock_stat*, int);
 
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
@@ -165,16 +232,22 @@ int             mappages(pagetable_t, uint64, uint64, uint64, int);
 pagetable_t     uvmcreate(void);
 uint64          uvmalloc(pagetable_t, uint64, uint64, int);
 uint64          uvmdealloc(pagetable_t, uint64, uint64);
+void            uvmprune(pagetable_t, uint64);
 int             uvmcopy(pagetable_t, pagetable_t, uint64);
 void            uvmfree(pagetable_t, uint64);
 void            uvmunmap(pagetable_t, uint64, uint64, int);
 void            uvmclear(pagetable_t, uint64);
 pte_t *         walk(pagetable_t, uint64, int);
+void            pgwalk_init(struct pgwalk*, pagetable_t, uint64, uint64);
+uint64          proc_satp(struct proc*);
+pte_t *         pgwalk_next(struct pgwalk*, uint64*);
 uint64          walkaddr(pagetable_t, uint64);
 int             copyout(pagetable_t, uint64, char *, uint64);
 int             copyin(pagetable_t, char *, uint64, uint64);
 int             copyinstr(pagetable_t, char *, uint64, uint64);
 int             ismapped(pagetable_t, uint64);
+int             upin(uint64, uint64, int);
+void            uunpin(void);
 uint64          vmfault(pagetable_t, uint64, int);
 
 // plic.c
@@ -186,6 +259,9 @@ void            plic_complete(int);
 // virtio_disk.c
 void            virtio_disk_init(void);
 void            virtio_disk_rw(struct buf *, int);
+void            virtio_disk_submit(struct buf **, int, int);
+void            virtio_disk_wait(struct buf *);
+void            virtio_disk_kick(void);
 void            virtio_disk_intr(void);
 
 // number of elements in fixed-size array
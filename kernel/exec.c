@@ -37,11 +37,16 @@ kexec(char *path, char **argv)
   pagetable_t pagetable = 0, oldpagetable;
   struct proc *p = myproc();
 
+  // The old image must stay put until it is replaced: no whole-process
+  // swap-out while exec sleeps on the disk.
+  p->vmbusy++;
+
   begin_op();
 
   // Open the executable file.
   if((ip = namei(path)) == 0){
     end_op();
+    p->vmbusy--;
     return -1;
   }
   ilock(ip);
@@ -62,13 +67,6 @@ kexec(char *path, char **argv)
     iput(p->exe_inode);
   p->exe_inode = idup(ip);
 
-  // Reset swap file state for this process
-  if(p->swap_inode) {
-    iput(p->swap_inode);
-    p->swap_inode = 0;
-  }
-  memset(p->swap_slots, 0, sizeof(p->swap_slots));
-
   // Calculate the size needed for code/data segments (for p->sz)
   // but do NOT allocate or load the pages.
   sz = 0;
@@ -145,13 +143,21 @@ kexec(char *path, char **argv)
   // Commit to the user image.
   oldpagetable = p->pagetable;
   p->pagetable = pagetable;
+  p->asid_gen = 0;  // new address space, new ASID
   p->sz = sz;
   p->trapframe->epc = elf.entry;  // initial program counter = main
   p->trapframe->sp = sp; // initial stack pointer
+  // The resident set describes only the old image; uvmunmap()
+  // leaves it alone now that the old page table is not p's.
+  acquire(&p->lock);
+  free_resident_set(p);
+  release(&p->lock);
   proc_freepagetable(oldpagetable, oldsz);
 
-  // Swap file will be created lazily when first needed (on page eviction)
-  p->swap_inode = 0;
+  // Nor does it free the old image's swap slots, swapped out or
+  // swap cache: free them all here. The swap file stays open, and
+  // its slots are reused by the new image.
+  memset(p->swap_slots, 0, sizeof(p->swap_slots));
 
   // Log initialization with lazy allocation ranges
   // For simplicity, we'll estimate text/data from the ELF segments
@@ -159,6 +165,7 @@ kexec(char *path, char **argv)
   printf("[pid %d] INIT-LAZYMAP text=[0x0,0x%lx) data=[0x%lx,0x%lx) heap_start=0x%lx stack_top=0x%lx\n",
          p->pid, p->exe_end, p->exe_end, sz, p->exe_end, sp);
 
+  p->vmbusy--;
   return argc; // this ends up in a0, the first argument to main(argc, argv)
 
  bad:
@@ -168,6 +175,7 @@ kexec(char *path, char **argv)
     iunlockput(ip);
     end_op();
   }
+  p->vmbusy--;
   return -1;
 }
 
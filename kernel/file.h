@@ -21,6 +21,10 @@ struct inode {
   struct sleeplock lock; // protects everything below here
   int valid;          // inode has been read from disk?
 
+  uint ra_next;       // block after the last one readi() read
+  uint ra_win;        // readahead window in blocks; 0 if not sequential
+  uint ra_end;        // block after the last one read ahead
+
   short type;         // copy of disk inode
   short major;
   short minor;
@@ -61,10 +61,12 @@ bzero(int dev, int bno)
 
 // Blocks.
 
-// Allocate a zeroed disk block.
+// Allocate a zeroed disk block. Unless direct, it is zeroed through
+// the log; a block that writei_direct() fills straight on disk is
+// left for it to zero, so that only the bitmap is logged.
 // returns 0 if out of disk space.
 static uint
-balloc(uint dev)
+balloc(uint dev, int direct)
 {
   int b, bi, m;
   struct buf *bp;
@@ -78,7 +80,8 @@ balloc(uint dev)
         bp->data[bi/8] |= m;  // Mark block in use.
         log_write(bp);
         brelse(bp);
-        bzero(dev, b + bi);
+        if(!direct)
+          bzero(dev, b + bi);
         return b + bi;
       }
     }
@@ -272,6 +275,7 @@ iget(uint dev, uint inum)
   ip->inum = inum;
   ip->ref = 1;
   ip->valid = 0;
+  ip->ra_next = ip->ra_win = ip->ra_end = 0;
   release(&itable.lock);
 
   return ip;
@@ -400,17 +404,18 @@ ireclaim(int dev)
 // listed in block ip->addrs[NDIRECT].
 
 // Return the disk block address of the nth block in inode ip.
-// If there is no such block, bmap allocates one.
+// If there is no such block, bmap allocates one; a data block
+// allocated for writei_direct() is not zeroed (see balloc()).
 // returns 0 if out of disk space.
 static uint
-bmap(struct inode *ip, uint bn)
+bmap_alloc(struct inode *ip, uint bn, int direct)
 {
   uint addr, *a;
   struct buf *bp;
 
   if(bn < NDIRECT){
     if((addr = ip->addrs[bn]) == 0){
-      addr = balloc(ip->dev);
+      addr = balloc(ip->dev, direct);
       if(addr == 0)
         return 0;
       ip->addrs[bn] = addr;
@@ -422,7 +427,7 @@ bmap(struct inode *ip, uint bn)
   if(bn < NINDIRECT){
     // Load indirect block, allocating if necessary.
     if((addr = ip->addrs[NDIRECT]) == 0){
-      addr = balloc(ip->dev);
+      addr = balloc(ip->dev, 0);
       if(addr == 0)
         return 0;
       ip->addrs[NDIRECT] = addr;
@@ -430,7 +435,7 @@ bmap(struct inode *ip, uint bn)
     bp = bread(ip->dev, addr);
     a = (uint*)bp->data;
     if((addr = a[bn]) == 0){
-      addr = balloc(ip->dev);
+      addr = balloc(ip->dev, direct);
       if(addr){
         a[bn] = addr;
         log_write(bp);
@@ -443,6 +448,12 @@ bmap(struct inode *ip, uint bn)
   panic("bmap: out of range");
 }
 
+static uint
+bmap(struct inode *ip, uint bn)
+{
+  return bmap_alloc(ip, bn, 0);
+}
+
 // Truncate inode (discard contents).
 // Caller must hold ip->lock.
 void
@@ -487,6 +498,48 @@ stati(struct inode *ip, struct stat *st)
   st->size = ip->size;
 }
 
+// Sequential readahead, after readi() has read blocks first..last
+// of ip. A read that starts in or right after the block where the
+// previous one stopped continues a stream: start reading the next
+// ra_win blocks into the buffer cache without waiting, doubling
+// the window up to RA_MAXWIN with each such read. Anything else
+// ends the stream. Caller must hold ip->lock.
+static void
+readahead(struct inode *ip, uint first, uint last)
+{
+  uint nblocks = (ip->size + BSIZE - 1) / BSIZE;
+  uint bn, end, addr;
+  int k;
+
+  if(first == ip->ra_next || first + 1 == ip->ra_next){
+    if(ip->ra_win == 0)
+      ip->ra_win = RA_MINWIN;
+    else if(ip->ra_win < RA_MAXWIN)
+      ip->ra_win *= 2;
+  } else {
+    ip->ra_win = 0;
+    ip->ra_end = 0;
+  }
+  ip->ra_next = last + 1;
+  if(ip->ra_win == 0 || ip->type != T_FILE)
+    return;
+
+  // Issue only what earlier readaheads have not, in runs of
+  // blocks that lie next to each other on disk.
+  bn = ip->ra_end > last + 1 ? ip->ra_end : last + 1;
+  end = last + 1 + ip->ra_win;
+  if(end > nblocks)
+    end = nblocks;
+  for(; bn < end; bn += k){
+    if((addr = bmap(ip, bn)) == 0)
+      break;
+    for(k = 1; k < SGBLOCKS && bn + k < end && bmap(ip, bn + k) == addr + k; k++)
+      ;
+    breadahead(ip->dev, addr, k);
+  }
+  ip->ra_end = bn;
+}
+
 // Read data from inode.
 // Caller must hold ip->lock.
 // If user_dst==1, then dst is a user virtual address;
@@ -495,29 +548,71 @@ int
 readi(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
 {
   uint tot, m;
-  struct buf *bp;
+  struct buf *bp, *bps[SGBLOCKS];
 
   if(off > ip->size || off + n < off)
     return 0;
   if(off + n > ip->size)
     n = ip->size - off;
 
-  for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
-    uint addr = bmap(ip, off/BSIZE);
+  for(tot=0; tot<n; ){
+    // Take as many of the remaining blocks as lie next to each
+    // other on disk, up to SGBLOCKS, and read them in one request.
+    uint bn = off/BSIZE, last = (off + n - tot - 1)/BSIZE;
+    uint addr = bmap(ip, bn);
     if(addr == 0)
       break;
-    bp = bread(ip->dev, addr);
-    m = min(n - tot, BSIZE - off%BSIZE);
-    if(either_copyout(user_dst, dst, bp->data + (off % BSIZE), m) == -1) {
+    int nb = 1, err = 0;
+    while(nb < SGBLOCKS && bn + nb <= last && bmap(ip, bn + nb) == addr + nb)
+      nb++;
+    // Fault the user buffer in before taking the bufs: a fault under
+    // them could evict, and the swap write could wait on the log,
+    // which could be waiting on these bufs.
+    if(user_dst && upin(dst, min(n - tot, nb*BSIZE - off%BSIZE), 1) < 0)
+      return -1;
+    bread_run(ip->dev, addr, nb, bps);
+    for(int i = 0; i < nb; i++){
+      bp = bps[i];
+      m = min(n - tot, BSIZE - off%BSIZE);
+      if(!err && either_copyout(user_dst, dst, bp->data + (off % BSIZE), m) == -1)
+        err = 1;
       brelse(bp);
-      tot = -1;
-      break;
+      tot += m, off += m, dst += m;
     }
-    brelse(bp);
+    if(user_dst)
+      uunpin();
+    if(err)
+      return -1;
   }
+  if(tot > 0)
+    readahead(ip, (off - tot)/BSIZE, (off - 1)/BSIZE);
   return tot;
 }
 
+// Start reading bytes [off, off+n) of ip into the buffer cache
+// without waiting, each run of adjacent blocks as one request, for
+// a caller that knows what it will read next. Caller must hold
+// ip->lock.
+void
+readi_ahead(struct inode *ip, uint off, uint n)
+{
+  uint bn, end, addr;
+  int k;
+
+  if(off >= ip->size || off + n < off)
+    return;
+  if(off + n > ip->size)
+    n = ip->size - off;
+  end = (off + n + BSIZE - 1)/BSIZE;
+  for(bn = off/BSIZE; bn < end; bn += k){
+    if((addr = bmap(ip, bn)) == 0)
+      break;
+    for(k = 1; k < SGBLOCKS && bn + k < end && bmap(ip, bn + k) == addr + k; k++)
+      ;
+    breadahead(ip->dev, addr, k);
+  }
+}
+
 // Write data to inode.
 // Caller must hold ip->lock.
 // If user_src==1, then src is a user virtual address;
@@ -561,6 +656,62 @@ writei(struct inode *ip, int user_src, uint64 src, uint off, uint n)
   return tot;
 }
 
+// Write n bytes from kernel address src to inode ip at off, like
+// writei(), but write the data blocks straight to disk instead of
+// through the log, each run of adjacent blocks as one request. For
+// files such as swap whose contents need not survive a crash. New
+// data blocks are zeroed here rather than through the log; the
+// bitmap, indirect block and inode they change are still logged, so
+// a write that grows the file must be inside a transaction that has
+// log space for them. One within the file needs none. Caller must
+// hold ip->lock.
+int
+writei_direct(struct inode *ip, uint64 src, uint off, uint n)
+{
+  uint tot, m, addr, last, oldblocks = (ip->size + BSIZE - 1)/BSIZE;
+  struct buf *bp[SGBLOCKS];
+  int grow, nb, i;
+
+  if(off > ip->size || off + n < off)
+    return -1;
+  if(off + n > MAXFILE*BSIZE)
+    return -1;
+  grow = off + n > ip->size;
+
+  for(tot = 0; tot < n; ){
+    if((addr = bmap_alloc(ip, off/BSIZE, 1)) == 0)
+      break;
+    last = (off + n - tot - 1)/BSIZE;
+    for(nb = 1; nb < SGBLOCKS && off/BSIZE + nb <= last; nb++)
+      if(bmap_alloc(ip, off/BSIZE + nb, 1) != addr + nb)
+        break;
+    for(i = 0; i < nb; i++, tot += m, off += m, src += m){
+      m = min(n - tot, BSIZE - off%BSIZE);
+      if(m == BSIZE || off/BSIZE >= oldblocks){
+        bp[i] = bgrab(ip->dev, addr + i);
+        if(m < BSIZE)
+          memset(bp[i]->data, 0, BSIZE);  // new block, not zeroed yet
+      } else {
+        bp[i] = bread(ip->dev, addr + i);
+      }
+      log_wait_install(addr + i);
+      memmove(bp[i]->data + off%BSIZE, (char*)src, m);
+    }
+    bwrite_run_start(bp, nb);
+    for(i = 0; i < nb; i++){
+      bwait(bp[i]);
+      brelse(bp[i]);
+    }
+  }
+
+  if(grow){
+    if(off > ip->size)
+      ip->size = off;
+    iupdate(ip);
+  }
+  return tot;
+}
+
 // Directories
 
 int
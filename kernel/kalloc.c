@@ -24,6 +24,8 @@ struct run {
 struct {
   struct spinlock lock;
   struct run *freelist;
+  uint64 nfree;      // pages on freelist
+  uint64 nframes;    // pages handed to kfree() by kinit()
 } kmem;
 
 void
@@ -38,8 +40,10 @@ freerange(void *pa_start, void *pa_end)
 {
   char *p;
   p = (char*)PGROUNDUP((uint64)pa_start);
-  for(; p + PGSIZE <= (char*)pa_end; p += PGSIZE)
+  for(; p + PGSIZE <= (char*)pa_end; p += PGSIZE){
     kfree(p);
+    kmem.nframes++;
+  }
 }
 
 // Free the page of physical memory pointed at by pa,
@@ -62,7 +66,35 @@ kfree(void *pa)
   acquire(&kmem.lock);
   r->next = kmem.freelist;
   kmem.freelist = r;
+  kmem.nfree++;
+  release(&kmem.lock);
+}
+
+// Take a page off the free list, or return 0.
+static void *
+kpop(void)
+{
+  struct run *r;
+
+  acquire(&kmem.lock);
+  r = kmem.freelist;
+  if(r) {
+    kmem.freelist = r->next;
+    kmem.nfree--;
+  }
   release(&kmem.lock);
+
+  if(r)
+    memset((void*)r, 5, PGSIZE); // fill with junk
+  return (void*)r;
+}
+
+// Allocate a page only if one is free, without taking memory
+// from anyone; for caches that must not push out user pages.
+void *
+kalloc_noreclaim(void)
+{
+  return kpop();
 }
 
 // Allocate one 4096-byte page of physical memory.
@@ -71,49 +103,44 @@ kfree(void *pa)
 void *
 kalloc(void)
 {
-  struct run *r;
+  void *r;
 
   // --- MODIFIED LOGIC WITH PAGE REPLACEMENT ---
-  // First, check if page is free (without holding lock long)
-  acquire(&kmem.lock);
-  r = kmem.freelist;
-  release(&kmem.lock);
-
-  if(r) {
+  // First, check if page is free
+  if((r = kpop()) != 0) {
     // Normal case: page is free
-    acquire(&kmem.lock);
-    kmem.freelist = r->next;
-    release(&kmem.lock);
-    memset((void*)r, 5, PGSIZE);
-    return (void*)r;
+    return r;
   }
 
   // No free page. Try to make one via page replacement.
   struct proc *p = myproc();
+  vmstat_add(VM_MEMFULL, 1);
   if(p) {
     printf("[pid %d] MEMFULL\n", p->pid);
   } else {
     printf("MEMFULL\n");
   }
 
-  // Try to evict a page from the current process
-  if(p && do_page_replacement(p) == 0) {
+  // Take back a page lent to the buffer cache first. Then prefer
+  // swapping out a long-idle process as a whole; otherwise try to
+  // evict a page from the current process
+  if(bshrink() == 0 && p && swapout_idle() == 0 && do_page_replacement(p) == 0) {
     // Failed to evict (process has no pages)
     return 0;
   }
 
   // Replacement succeeded, try one more time to kalloc
+  return kpop(); // Return page or 0 if still failed
+}
+
+// Report the number of frames kalloc() manages and how many are free.
+void
+kmemstat(uint64 *total, uint64 *nfree)
+{
   acquire(&kmem.lock);
-  r = kmem.freelist;
-  if(r) {
-    kmem.freelist = r->next;
-  }
+  *total = kmem.nframes;
+  *nfree = kmem.nfree;
   release(&kmem.lock);
-
-  if(r)
-    memset((void*)r, 5, PGSIZE);
-
-  return (void*)r; // Return page or 0 if still failed
 }
 
 //############## LLM Generated Code Ends ################
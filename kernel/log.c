@@ -6,6 +6,7 @@
 #include "sleeplock.h"
 #include "fs.h"
 #include "buf.h"
+#include "proc.h"
 
 // Simple logging that allows concurrent FS system calls.
 //
@@ -21,6 +22,21 @@
 // But if it thinks the log is close to running out, it
 // sleeps until the last outstanding end_op() commits.
 //
+// Group commit: the end_op() that leaves no system call active
+// becomes the leader of the commit. If the previous transaction
+// was shared by several system calls, the leader first waits up
+// to LOGDELAY for more to join, unless LOGGROUP blocks are logged
+// already. Every end_op() returns once its transaction is on disk.
+//
+// The in-memory log header is double-buffered: once a transaction
+// has been written to the log, it moves to clh and is installed
+// from there, while new system calls log into lh. They can not
+// commit until the install is done, since that needs the on-disk
+// log. The install writes private copies of the blocks, so the
+// cached blocks may meanwhile hold newer, uncommitted updates.
+// Writes that bypass the log (writei_direct()) must wait for the
+// install of any block they write, or it would undo them.
+//
 // The log is a physical re-do log containing disk blocks.
 // The on-disk log format:
 //   header block, containing block #s for block A, B, C, ...
@@ -42,13 +58,25 @@ struct log {
   int start;
   int outstanding; // how many FS sys calls are executing.
   int committing;  // in commit(), please wait.
+  int leader;      // an end_op() is gathering a group to commit.
+  int installing;  // clh is being installed.
   int dev;
-  struct logheader lh;
+  uint seq;        // number of the open transaction.
+  uint done;       // last transaction that is on disk.
+  int nops;        // sys calls that joined the open transaction.
+  int lastgroup;   // sys calls that shared the last commit.
+  struct logheader lh;         // the open transaction
+  struct buf *pinned[LOGBLOCKS]; // cached bufs of lh.block[]
+  struct logheader clh;        // committed, being installed
+  struct buf *cpinned[LOGBLOCKS];
 };
 struct log log;
 
+// Private buffers for install_trans(); not in the buffer cache.
+static struct buf ibuf[LOGBATCH];
+
 static void recover_from_log(void);
-static void commit();
+static void commit(void);
 
 void
 initlog(int dev, struct superblock *sb)
@@ -57,29 +85,42 @@ initlog(int dev, struct superblock *sb)
     panic("initlog: too big logheader");
 
   initlock(&log.lock, "log");
+  for (int i = 0; i < LOGBATCH; i++)
+    initsleeplock(&ibuf[i].lock, "logibuf");
   log.start = sb->logstart;
   log.dev = dev;
+  log.seq = 1;
   recover_from_log();
 }
 
-// Copy committed blocks from log to their home location
+// Copy the blocks of committed transaction lh from log to their
+// home location, LOGBATCH disk writes at a time. pinned[] are the
+// cached bufs log_write() pinned for them, or 0 when recovering.
 static void
-install_trans(int recovering)
+install_trans(struct logheader *lh, struct buf **pinned)
 {
-  int tail;
+  int tail, i, n;
 
-  for (tail = 0; tail < log.lh.n; tail++) {
-    if(recovering) {
-      printf("recovering tail %d dst %d\n", tail, log.lh.block[tail]);
+  for (tail = 0; tail < lh->n; tail += n) {
+    n = lh->n - tail < LOGBATCH ? lh->n - tail : LOGBATCH;
+    for (i = 0; i < n; i++) {
+      if(pinned == 0) {
+        printf("recovering tail %d dst %d\n", tail+i, lh->block[tail+i]);
+      }
+      struct buf *lbuf = bread(log.dev, log.start+tail+i+1); // read log block
+      acquiresleep(&ibuf[i].lock);
+      ibuf[i].dev = log.dev;
+      ibuf[i].blockno = lh->block[tail+i];
+      memmove(ibuf[i].data, lbuf->data, BSIZE);  // copy block to dst
+      brelse(lbuf);
+      bwrite_start(&ibuf[i]);  // write dst to disk
+    }
+    for (i = 0; i < n; i++) {
+      bwait(&ibuf[i]);
+      releasesleep(&ibuf[i].lock);
+      if(pinned)
+        bunpin(pinned[tail+i]);
     }
-    struct buf *lbuf = bread(log.dev, log.start+tail+1); // read log block
-    struct buf *dbuf = bread(log.dev, log.lh.block[tail]); // read dst
-    memmove(dbuf->data, lbuf->data, BSIZE);  // copy block to dst
-    bwrite(dbuf);  // write dst to disk
-    if(recovering == 0)
-      bunpin(dbuf);
-    brelse(lbuf);
-    brelse(dbuf);
   }
 }
 
@@ -97,18 +138,18 @@ read_head(void)
   brelse(buf);
 }
 
-// Write in-memory log header to disk.
+// Write log header lh to disk.
 // This is the true point at which the
 // current transaction commits.
 static void
-write_head(void)
+write_head(struct logheader *lh)
 {
   struct buf *buf = bread(log.dev, log.start);
   struct logheader *hb = (struct logheader *) (buf->data);
   int i;
-  hb->n = log.lh.n;
-  for (i = 0; i < log.lh.n; i++) {
-    hb->block[i] = log.lh.block[i];
+  hb->n = lh->n;
+  for (i = 0; i < lh->n; i++) {
+    hb->block[i] = lh->block[i];
   }
   bwrite(buf);
   brelse(buf);
@@ -118,9 +159,9 @@ static void
 recover_from_log(void)
 {
   read_head();
-  install_trans(1); // if committed, copy from log to disk
+  install_trans(&log.lh, 0); // if committed, copy from log to disk
   log.lh.n = 0;
-  write_head(); // clear the log
+  write_head(&log.lh); // clear the log
 }
 
 // called at the start of each FS system call.
@@ -136,73 +177,180 @@ begin_op(void)
       sleep(&log, &log.lock);
     } else {
       log.outstanding += 1;
+      log.nops += 1;
       release(&log.lock);
+      myproc()->in_op++;
       break;
     }
   }
 }
 
 // called at the end of each FS system call.
-// commits if this was the last outstanding operation.
+// commits if this was the last outstanding operation,
+// and returns once the operation is on disk.
 void
 end_op(void)
 {
-  int do_commit = 0;
+  uint seq;
 
+  myproc()->in_op--;
   acquire(&log.lock);
   log.outstanding -= 1;
   if(log.committing)
     panic("log.committing");
+  seq = log.seq;
+  // begin_op() may be waiting for log space,
+  // and decrementing log.outstanding has decreased
+  // the amount of reserved space.
+  wakeup(&log);
   if(log.outstanding == 0){
-    do_commit = 1;
-    log.committing = 1;
-  } else {
-    // begin_op() may be waiting for log space,
-    // and decrementing log.outstanding has decreased
-    // the amount of reserved space.
-    wakeup(&log);
+    if(log.leader){
+      // the leader of the group commit is waiting for us.
+      wakeup(&log.leader);
+    } else {
+      // commit() is called with log.lock held, and
+      // returns with it held.
+      commit();
+    }
   }
+  while(log.done < seq)
+    sleep(&log, &log.lock);
   release(&log.lock);
+}
 
-  if(do_commit){
-    // call commit w/o holding locks, since not allowed
-    // to sleep with locks.
-    commit();
-    acquire(&log.lock);
-    log.committing = 0;
-    wakeup(&log);
-    release(&log.lock);
+// Reserve log space for another MAXOPBLOCKS inside the caller's
+// system call, for work nested in it that its own reservation does
+// not cover: growing a swap file from a page fault. Never waits,
+// since the commit that would free space must wait for the caller.
+// Returns 1 if reserved, 0 if the log is too full.
+// log_unreserve() gives it back without ending the system call.
+int
+log_reserve(void)
+{
+  int r = 0;
+
+  acquire(&log.lock);
+  if(!log.committing && log.lh.n + (log.outstanding+1)*MAXOPBLOCKS <= LOGBLOCKS){
+    log.outstanding += 1;
+    r = 1;
   }
+  release(&log.lock);
+  return r;
 }
 
-// Copy modified blocks from cache to log.
+void
+log_unreserve(void)
+{
+  acquire(&log.lock);
+  log.outstanding -= 1;  // never the last: the caller's op remains
+  wakeup(&log);
+  release(&log.lock);
+}
+
+// Copy modified blocks from cache to log. The log blocks are
+// adjacent, so each LOGBATCH of them is one disk request.
 static void
 write_log(void)
 {
-  int tail;
-
-  for (tail = 0; tail < log.lh.n; tail++) {
-    struct buf *to = bread(log.dev, log.start+tail+1); // log block
-    struct buf *from = bread(log.dev, log.lh.block[tail]); // cache block
-    memmove(to->data, from->data, BSIZE);
-    bwrite(to);  // write the log
-    brelse(from);
-    brelse(to);
+  int tail, i, n;
+  struct buf *to[LOGBATCH];
+
+  for (tail = 0; tail < log.lh.n; tail += n) {
+    n = log.lh.n - tail < LOGBATCH ? log.lh.n - tail : LOGBATCH;
+    bread_run(log.dev, log.start+tail+1, n, to); // log blocks
+    for (i = 0; i < n; i++) {
+      struct buf *from = bread(log.dev, log.lh.block[tail+i]); // cache block
+      memmove(to[i]->data, from->data, BSIZE);
+      brelse(from);
+    }
+    bwrite_run_start(to, n);  // write the log
+    for (i = 0; i < n; i++) {
+      bwait(to[i]);
+      brelse(to[i]);
+    }
   }
 }
 
+// Lead the commit of the open transaction, once no FS system
+// call is active. Caller must hold log.lock; it is released
+// while writing to disk, since not allowed to sleep with locks.
 static void
-commit()
+commit(void)
 {
+  uint64 deadline = r_time() + (log.lastgroup > 1 ? LOGDELAY : 0);
+  struct logheader empty;
+  int n;
+
+  // Give other system calls a chance to join the group.
+  log.leader = 1;
+  while(log.outstanding > 0 ||
+        (log.lh.n < LOGGROUP && r_time() < deadline)){
+    if(log.outstanding > 0){
+      sleep(&log.leader, &log.lock);
+    } else {
+      release(&log.lock);
+      yield();
+      acquire(&log.lock);
+    }
+  }
+  log.leader = 0;
+
+  // Keep new system calls out, and wait for the previous
+  // transaction to be done with the on-disk log.
+  log.committing = 1;
+  while(log.installing)
+    sleep(&log, &log.lock);
+  release(&log.lock);
+
   if (log.lh.n > 0) {
     write_log();     // Write modified blocks from cache to log
-    write_head();    // Write header to disk -- the real commit
-    install_trans(0); // Now install writes to home locations
-    log.lh.n = 0;
-    write_head();    // Erase the transaction from the log
+    write_head(&log.lh);    // Write header to disk -- the real commit
+  }
+
+  // The transaction is on disk: let new system calls in while
+  // it is installed.
+  acquire(&log.lock);
+  n = log.lh.n;
+  log.clh = log.lh;
+  memmove(log.cpinned, log.pinned, sizeof(log.pinned));
+  log.lh.n = 0;
+  log.lastgroup = log.nops;
+  log.nops = 0;
+  log.done = log.seq++;
+  log.committing = 0;
+  log.installing = n > 0;
+  wakeup(&log);
+
+  if (n > 0) {
+    release(&log.lock);
+    install_trans(&log.clh, log.cpinned); // Now install writes to home locations
+    empty.n = 0;
+    write_head(&empty);    // Erase the transaction from the log
+    acquire(&log.lock);
+    log.installing = 0;
+    wakeup(&log);
   }
 }
 
+// Wait until block blockno is not part of a committed transaction
+// that is still being installed.
+void
+log_wait_install(uint blockno)
+{
+  int i;
+
+  acquire(&log.lock);
+  while(log.installing){
+    for(i = 0; i < log.clh.n; i++)
+      if(log.clh.block[i] == blockno)
+        break;
+    if(i == log.clh.n)
+      break;
+    sleep(&log, &log.lock);
+  }
+  release(&log.lock);
+}
+
 // Caller has modified b->data and is done with the buffer.
 // Record the block number and pin in the cache by increasing refcnt.
 // commit()/write_log() will do the disk write.
@@ -230,6 +378,7 @@ log_write(struct buf *b)
   log.lh.block[i] = b->blockno;
   if (i == log.lh.n) {  // Add new block to log?
     bpin(b);
+    log.pinned[i] = b;
     log.lh.n++;
   }
   release(&log.lock);
@@ -20,6 +20,8 @@ main()
     kvminit();       // create kernel page table
     kvminithart();   // turn on paging
     procinit();      // process table
+    profinit();      // sampling profiler
+    pgtraceinit();   // page-reference tracing
     trapinit();      // trap vectors
     trapinithart();  // install kernel trap vector
     plicinit();      // set up interrupt controller
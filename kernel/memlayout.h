@@ -17,6 +17,11 @@
 // end -- start of kernel page allocation area
 // PHYSTOP -- end RAM used by the kernel
 
+// core local interruptor (CLINT); writing 1 to a hart's MSIP
+// register raises a machine-mode software interrupt on it (an IPI).
+#define CLINT 0x02000000L
+#define CLINT_MSIP(hartid) (CLINT + 4*(hartid))
+
 // qemu puts UART registers here in physical memory.
 #define UART0 0x10000000L
 #define UART0_IRQ 10
@@ -37,7 +42,10 @@
 // for use by the kernel and user pages
 // from physical address 0x80000000 to PHYSTOP.
 #define KERNBASE 0x80000000L
-#define PHYSTOP (KERNBASE + 128*1024*1024)
+#ifndef MEMSIZE_MB
+#define MEMSIZE_MB 128   // set by the Makefile from MEM
+#endif
+#define PHYSTOP (KERNBASE + MEMSIZE_MB*1024L*1024)
 
 // map the trampoline page to the highest address,
 // in both user and kernel space.
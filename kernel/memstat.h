@@ -27,6 +27,146 @@ struct proc_mem_stat {
   struct page_stat pages[MAX_PAGES_INFO];
 };
 
+// One page, as reported by memstat2(). Only pages that are
+// resident or swapped out are listed; the rest are UNMAPPED.
+struct page_stat2 {
+  uint64 va;
+  int state;               // RESIDENT or SWAPPED
+  int is_dirty;
+  int seq;                 // FIFO seq of a resident page, else -1
+  int swap_slot;           // Slot of a swapped page, or of the swap-cache
+                           // copy of a resident page, else -1
+};
+
+// Page-fault causes, indexing proc_vm_stat.faults[].
+#define FAULT_HEAP  0
+#define FAULT_STACK 1
+#define FAULT_EXEC  2
+#define FAULT_SWAP  3
+#define NFAULT      4
+
+// Per-process paging state and cumulative counters, see memstat2().
+struct proc_vm_stat {
+  int pid;
+  int npages;              // Entries memstat2() stored in the buffer
+  uint64 sz;               // Process size in bytes
+  int num_resident_pages;
+  int num_swap_slots;      // Swap slots in use, swap-cache copies included
+  int next_fifo_seq;
+  uint64 faults[NFAULT];   // Page faults taken, by cause
+  uint64 swapins;          // Pages read back from swap
+  uint64 swapouts;         // Pages written to swap
+  uint64 exec_bytes;       // Bytes read from the executable image
+  uint64 evictions;        // Resident pages taken away by replacement
+  uint64 fault_time;       // Time spent handling page faults, in r_time() units
+};
+
+// Page-fault latency classes, indexing fault_stat.hist[]. A fault
+// that had to evict a page to get memory counts as FLAT_SWAPOUT,
+// whatever it went on to do.
+#define FLAT_ALLOC    0    // fresh heap or stack page
+#define FLAT_LOADEXEC 1    // page read from the executable
+#define FLAT_SWAPIN   2    // page read back from swap
+#define FLAT_SWAPOUT  3    // memory was full: evicted first
+#define NFLAT         4
+
+#define FHIST_NBUCKET 32
+
+// Latency histogram, in r_time() units. bucket[i] counts faults
+// that took [2^i, 2^(i+1)) units; bucket[0] also counts 0.
+struct fault_hist {
+  uint64 count;
+  uint64 total;            // Sum of all latencies
+  uint64 max;
+  uint bucket[FHIST_NBUCKET];
+};
+
+// Fault latencies of a process, or of the whole system, see faultstat().
+struct fault_stat {
+  struct fault_hist hist[NFLAT];
+};
+
+// System-wide event counters, indexing vm_stat.count[].
+#define VM_PGFAULT     0   // user page faults
+#define VM_MEMFULL     1   // kalloc() found no free frame
+#define VM_SCAN        2   // resident pages examined to pick a victim
+#define VM_EVICT       3   // resident pages evicted
+#define VM_SWAPIN      4   // pages read back from swap
+#define VM_SWAPOUT     5   // pages written to swap
+#define VM_PROCSWAPOUT 6   // whole processes swapped out
+#define VM_BCACHE_HIT  7   // bget() found the block cached
+#define VM_BCACHE_MISS 8   // bget() had to recycle a buffer
+#define VM_DISK_READ   9   // blocks read from disk
+#define VM_DISK_WRITE  10  // blocks written to disk
+#define VM_READAHEAD   11  // blocks read ahead of sequential readi()
+#define VM_RA_HIT      12  // read-ahead blocks later asked for
+#define VM_RA_MISS     13  // read-ahead blocks recycled without being used
+#define NVMSTAT        14
+
+// Snapshot of system-wide memory state, see vmstat().
+struct vm_stat {
+  uint64 ticks;            // Clock ticks at the time of the snapshot
+  uint64 total_frames;     // Physical frames managed by kalloc()
+  uint64 free_frames;
+  uint64 resident_pages;   // User pages resident, all processes
+  uint64 swap_slots;       // Swap slots in use, all processes
+  uint64 count[NVMSTAT];   // Cumulative VM_* counts since boot
+};
+
+// One profiler sample, see profread().
+#define PROF_USER 1        // pc is a user address in process pid
+struct prof_sample {
+  uint64 pc;
+  int pid;                 // 0 if no process was running
+  short cpu;
+  short flags;
+  char name[16];           // Name of process pid
+};
+
+// Statistics of all spinlocks with one name, see lockstat().
+struct lock_stat {
+  char name[16];
+  uint64 nacquire;         // Acquisitions
+  uint64 ncontended;       // Acquisitions that found the lock held
+  uint64 nspin;            // Failed test-and-set attempts while spinning
+  uint64 total_hold;       // Time held, in r_time() units
+  uint64 max_hold;         // Longest single hold
+};
+
+// One page-reference trace record, see pgtraceread(): the pages
+// vpn .. vpn+63 of process pid that were accessed (abits) and, of
+// those, dirty (dbits) in the sampling interval ending at tick.
+struct pgtrace_rec {
+  uint tick;
+  int pid;
+  uint64 vpn;              // Virtual page number, a multiple of 64
+  uint64 abits;            // Bit i: page vpn+i was accessed
+  uint64 dbits;            // Bit i: page vpn+i is dirty
+};
+
+// Scheduling state of one process, see schedinfo().
+struct sched_info {
+  int pid;
+  int state;               // 2 sleeping, 3 runnable, 4 running, 5 zombie
+  int priority;            // MLFQ level, 0 is highest
+  int slice;               // Ticks used of the quantum at this level
+  uint64 cputime;          // Time spent running, in r_time() units
+  uint64 nsched;           // Times dispatched by the scheduler
+  uint64 nfault_demote;    // Demotions for faulting heavily
+  char name[16];
+};
+
+// System-wide thrashing / load-control state, see thrashstat().
+struct thrash_stat {
+  int thrashing;           // 1 while the system is considered to be thrashing
+  int num_deactivated;     // Processes currently suspended by load control
+  int window;              // Sampling window in ticks
+  uint fault_rate;         // Page faults during the last window
+  uint swapin_rate;        // Swap-ins during the last window
+  uint deactivations;      // Total processes deactivated since boot
+  uint reactivations;      // Total processes reactivated since boot
+};
+
 #endif
 
 //############## LLM Generated Code Ends ################
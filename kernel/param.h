@@ -9,7 +9,30 @@
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGBLOCKS    (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       2000  // size of file system in blocks
+#define NBUFBUCKET   13  // hash buckets of the disk block cache
+#define BCACHE_MAXPAGES 512  // pages the disk block cache may borrow from kalloc()
+#define RA_MINWIN     4  // blocks read ahead once a file is read sequentially
+#define RA_MAXWIN    32  // largest readahead window, in blocks
+#define SGBLOCKS      4  // max adjacent blocks moved by one disk request
+#define LOGBATCH     SGBLOCKS  // log writes queued on the disk at once
+#define LOGDELAY  10000  // r_time() units (1 ms) a commit waits for more FS calls to join
+#define LOGGROUP  (LOGBLOCKS-MAXOPBLOCKS)  // logged blocks that commit without waiting
+#define FSSIZE       4000  // size of file system in blocks
 #define MAXPATH      128   // maximum file path name
 #define USERSTACK    1     // user stack pages
 
+#define THRASH_WINDOW      10  // ticks per thrashing-detection sample
+#define THRASH_FAULT_HIGH 128  // faults per window that suggest thrashing
+#define THRASH_SWAPIN_HIGH 64  // swap-ins per window that confirm thrashing
+#define THRASH_SWAPIN_LOW  16  // swap-ins per window at which pressure has dropped
+#define SWAPOUT_IDLE_TICKS 50  // sleep this long before a whole process may be swapped out
+#define SWAPIN_AHEAD  4  // pages of a swapped-out image read ahead while it is reloaded
+#define UCOPY_BATCH  16  // user pages faulted in and pinned at a time by copyin/copyout
+#define TLBBATCH_MAX 16  // pages invalidated one by one before flushing a whole ASID
+#define PROF_NSAMPLE 512 // profiler samples buffered per CPU
+#define NLOCKSTAT    64  // distinct lock names with statistics (make LOCKSTAT=1)
+#define PGTRACE_NREC 1024 // page-reference trace records buffered
+#define NWAITQ       64  // hash buckets of sleep channels
+#define NMLFQ         3  // scheduler priority levels; level i runs 1<<i ticks at a time
+#define MLFQ_BOOST   30  // ticks between moves of every process back to level 0
+#define MLFQ_FAULT_DEMOTE 64 // page faults at one level that demote a process; 0 never
@@ -0,0 +1,154 @@
+//############## LLM Generated Code Begins ##############
+
+// Page-reference tracing.
+//
+// While a process is traced, every PGTRACE interval ticks its timer
+// interrupt scans its page table, records which pages were accessed
+// (PTE_A) and which of those are dirty (PTE_D), and clears PTE_A for
+// the next interval. The records, one per 64-page group with any
+// access, go to a ring that pgtraceread() drains. The reference
+// strings can then be replayed offline by tools/pgsim.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+#include "memstat.h"
+
+struct {
+  struct spinlock lock;
+  int pid;              // traced process, or 0
+  int interval;         // ticks between samples
+  int done;             // the traced process has exited
+  uint last;            // tick of the last sample
+  uint r, w;            // records read and written
+  uint dropped;         // records lost because the ring was full
+  struct pgtrace_rec rec[PGTRACE_NREC];
+} pgtr;
+
+void
+pgtraceinit(void)
+{
+  initlock(&pgtr.lock, "pgtrace");
+}
+
+static void
+pgtrace_put(struct pgtrace_rec *r)
+{
+  acquire(&pgtr.lock);
+  if(pgtr.w - pgtr.r == PGTRACE_NREC)
+    pgtr.dropped++;
+  else
+    pgtr.rec[pgtr.w++ % PGTRACE_NREC] = *r;
+  release(&pgtr.lock);
+}
+
+// Sample and clear the accessed bits of p if it is being traced
+// and its interval is up. Called by usertrap() on timer interrupts.
+void
+pgtrace_tick(struct proc *p)
+{
+  struct pgtrace_rec r;
+  struct tlbbatch b;
+  struct pgwalk w;
+  pte_t *pte;
+  uint64 va;
+  uint now = ticks;
+
+  if(p->pid != pgtr.pid || now - pgtr.last < pgtr.interval)
+    return;
+  pgtr.last = now;
+
+  r.tick = now;
+  r.pid = p->pid;
+  r.vpn = 0;
+  r.abits = r.dbits = 0;
+  tlb_batch_init(&b, p);
+  pgwalk_init(&w, p->pagetable, 0, TRAPFRAME);
+  while((pte = pgwalk_next(&w, &va)) != 0){
+    if((*pte & (PTE_V | PTE_U)) != (PTE_V | PTE_U) || (*pte & PTE_A) == 0)
+      continue;
+    uint64 vpn = va / PGSIZE;
+    if(vpn / 64 * 64 != r.vpn){
+      if(r.abits)
+        pgtrace_put(&r);
+      r.vpn = vpn / 64 * 64;
+      r.abits = r.dbits = 0;
+    }
+    r.abits |= 1UL << (vpn % 64);
+    if(*pte & PTE_D)
+      r.dbits |= 1UL << (vpn % 64);
+    *pte &= ~PTE_A;
+    tlb_batch_add(&b, va);
+  }
+  if(r.abits)
+    pgtrace_put(&r);
+  tlb_batch_flush(&b);
+}
+
+// Trace process pid every interval ticks, discarding any earlier
+// trace; interval 0 stops tracing. Returns the number of records
+// the previous trace dropped.
+int
+pgtrace_start(int pid, int interval)
+{
+  int dropped;
+
+  acquire(&pgtr.lock);
+  dropped = pgtr.dropped;
+  pgtr.pid = interval > 0 ? pid : 0;
+  pgtr.interval = interval;
+  pgtr.done = 0;
+  pgtr.last = 0;
+  pgtr.r = pgtr.w = 0;
+  pgtr.dropped = 0;
+  release(&pgtr.lock);
+  return dropped;
+}
+
+// p is exiting: end its trace, if it has one.
+void
+pgtrace_exit(struct proc *p)
+{
+  acquire(&pgtr.lock);
+  if(p->pid == pgtr.pid){
+    pgtr.pid = 0;
+    pgtr.done = 1;
+  }
+  release(&pgtr.lock);
+}
+
+// Move up to n records to user address dst. Returns the number
+// moved, or -1 once the traced process has exited and every record
+// has been read (or on error).
+int
+pgtrace_read(uint64 dst, int n)
+{
+  struct pgtrace_rec *kbuf;
+  int chunk = PGSIZE / sizeof(struct pgtrace_rec);
+  int total = 0, k;
+
+  if((kbuf = (struct pgtrace_rec *)kalloc()) == 0)
+    return -1;
+  do {
+    acquire(&pgtr.lock);
+    for(k = 0; k < chunk && total + k < n && pgtr.r != pgtr.w; k++)
+      kbuf[k] = pgtr.rec[pgtr.r++ % PGTRACE_NREC];
+    if(k == 0 && total == 0 && pgtr.done)
+      total = -1;
+    release(&pgtr.lock);
+    if(k > 0 && copyout(myproc()->pagetable, dst + total * sizeof(struct pgtrace_rec),
+                        (char *)kbuf, k * sizeof(struct pgtrace_rec)) < 0){
+      total = -1;
+      break;
+    }
+    total += k;
+  } while(k > 0);
+  kfree(kbuf);
+  return total;
+}
+
+//############## LLM Generated Code Ends ################
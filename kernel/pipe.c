@@ -79,14 +79,18 @@ pipewrite(struct pipe *pi, uint64 addr, int n)
   int i = 0;
   struct proc *pr = myproc();
 
+  // Readers and writers are woken one at a time; whoever leaves
+  // data or space behind passes the wakeup on to the next one.
   acquire(&pi->lock);
   while(i < n){
     if(pi->readopen == 0 || killed(pr)){
+      if(pi->nwrite < pi->nread + PIPESIZE)
+        wakeup_one(&pi->nwrite);
       release(&pi->lock);
       return -1;
     }
     if(pi->nwrite == pi->nread + PIPESIZE){ //DOC: pipewrite-full
-      wakeup(&pi->nread);
+      wakeup_one(&pi->nread);
       sleep(&pi->nwrite, &pi->lock);
     } else {
       char ch;
@@ -96,7 +100,9 @@ pipewrite(struct pipe *pi, uint64 addr, int n)
       i++;
     }
   }
-  wakeup(&pi->nread);
+  wakeup_one(&pi->nread);
+  if(pi->nwrite < pi->nread + PIPESIZE)
+    wakeup_one(&pi->nwrite);
   release(&pi->lock);
 
   return i;
@@ -112,6 +118,8 @@ piperead(struct pipe *pi, uint64 addr, int n)
   acquire(&pi->lock);
   while(pi->nread == pi->nwrite && pi->writeopen){  //DOC: pipe-empty
     if(killed(pr)){
+      // pass on the wakeup this reader may have been handed.
+      wakeup_one(&pi->nread);
       release(&pi->lock);
       return -1;
     }
@@ -124,7 +132,9 @@ piperead(struct pipe *pi, uint64 addr, int n)
     if(copyout(pr->pagetable, addr + i, &ch, 1) == -1)
       break;
   }
-  wakeup(&pi->nwrite);  //DOC: piperead-wakeup
+  wakeup_one(&pi->nwrite);  //DOC: piperead-wakeup
+  if(pi->nread < pi->nwrite)
+    wakeup_one(&pi->nread);
   release(&pi->lock);
   return i;
 }
@@ -8,7 +8,10 @@
 #include "proc.h"
 #include "defs.h"
 #include "fs.h"
+#include "sleeplock.h"
+#include "file.h"
 #include "stat.h"
+#include "memstat.h"
 
 struct cpu cpus[NCPU];
 
@@ -21,9 +24,74 @@ struct spinlock pid_lock;
 
 extern void forkret(void);
 static void freeproc(struct proc *p);
+static void swapimg_free(struct proc *p);
 
 extern char trampoline[]; // trampoline.S
 
+// Load control: system-wide paging activity is sampled every
+// THRASH_WINDOW ticks by loadctl_tick(). While the fault and
+// swap-in rates say the system is thrashing, the biggest memory
+// users are deactivated (swapped out and suspended) one at a time
+// until the swap-in rate falls, then reactivated in the same order.
+struct {
+  struct spinlock lock;
+  uint faults;          // page faults in the current window
+  uint swapins;         // swap-ins in the current window
+  uint window_start;    // tick at which the current window began
+  int thrashing;
+  int ndeactivated;
+  uint fault_rate;      // faults during the last complete window
+  uint swapin_rate;     // swap-ins during the last complete window
+  uint deactivations;
+  uint reactivations;
+} loadctl;
+
+static void loadctl_exit(struct proc *p);
+
+// System-wide page-fault latency histograms; each process
+// also keeps its own in p->fstat.
+struct {
+  struct spinlock lock;
+  struct fault_stat fs;
+} faultlat;
+
+// Per-CPU run queues of RUNNABLE processes. A process is queued on
+// the CPU it last ran on, to keep its cache warm, and a CPU with an
+// empty queue steals from the longest one. Queued processes are
+// exactly the RUNNABLE ones not held back by swap_busy.
+// Each run queue keeps one FIFO list per MLFQ level.
+// Lock order: p->lock, then a run-queue lock.
+struct runq {
+  struct spinlock lock;
+  struct proc *head[NMLFQ], *tail[NMLFQ];
+  int n;
+} __attribute__ ((aligned (64)));
+
+// Multi-level feedback queue. A process starts at level 0 and
+// drops a level each time it uses up its quantum of 1<<level
+// ticks, or takes MLFQ_FAULT_DEMOTE page faults at one level.
+// mlfq_boost() moves everything back to level 0 every MLFQ_BOOST
+// ticks by bumping mlfq_epoch; a process notices on its next trip
+// through the scheduler, see mlfq_refresh().
+static uint mlfq_epoch;
+
+static struct runq runq[NCPU];
+static void runq_push(struct proc *p);
+static struct proc *runq_pop(struct runq *rq);
+static struct proc *runq_steal(void);
+
+// Hashed wait queues. sleep() links the process onto the queue of
+// its channel's bucket, so wakeup() only looks at processes that
+// sleep on channels hashing there, instead of at every process.
+// Lock order: the sleep condition lock, then a wait-queue lock,
+// then p->lock.
+struct waitq {
+  struct spinlock lock;
+  struct proc *head, *tail;
+} __attribute__ ((aligned (64)));
+
+static struct waitq waitq[NWAITQ];
+
 // helps ensure that wakeups of wait()ing
 // parents are not lost. helps obey the
 // memory model when using p->parent.
@@ -55,6 +123,12 @@ procinit(void)
   
   initlock(&pid_lock, "nextpid");
   initlock(&wait_lock, "wait_lock");
+  initlock(&loadctl.lock, "loadctl");
+  initlock(&faultlat.lock, "faultlat");
+  for(int i = 0; i < NCPU; i++)
+    initlock(&runq[i].lock, "runq");
+  for(int i = 0; i < NWAITQ; i++)
+    initlock(&waitq[i].lock, "waitq");
   for(p = proc; p < &proc[NPROC]; p++) {
       initlock(&p->lock, "proc");
       p->state = UNUSED;
@@ -166,11 +240,43 @@ found:
   // Initialize resident set fields
   p->resident_set_head = 0;
   p->resident_set_tail = 0;
+  p->nresident = 0;
 
   // Initialize swap fields
   p->swap_inode = 0;
   memset(p->swap_slots, 0, sizeof(p->swap_slots));
 
+  // Initialize whole-process swapping fields
+  p->sleep_since = 0;
+  p->vmbusy = 0;
+  p->swap_busy = 0;
+  p->swapped_out = 0;
+  p->in_swapout = 0;
+  p->swapimg = 0;
+  p->pin_lo = p->pin_hi = 0;
+  p->asid = 0;
+  p->asid_gen = 0;
+  p->tlb_stale = 0;
+
+  // Initialize paging counters
+  memset(p->nfault, 0, sizeof(p->nfault));
+  p->nswapin = 0;
+  p->nswapout = 0;
+  p->exec_bytes = 0;
+  p->nevicted = 0;
+  p->fault_time = 0;
+  memset(&p->fstat, 0, sizeof(p->fstat));
+  p->pageio = 0;
+
+  // Start at the top MLFQ level.
+  p->priority = 0;
+  p->slice = 0;
+  p->level_faults = 0;
+  p->mlfq_epoch = mlfq_epoch;
+  p->cputime = 0;
+  p->nsched = 0;
+  p->nfault_demote = 0;
+
   // Allocate a trapframe page.
   if((p->trapframe = (struct trapframe *)kalloc()) == 0){
     freeproc(p);
@@ -204,6 +310,9 @@ freeproc(struct proc *p)
   if(p->trapframe)
     kfree((void*)p->trapframe);
   p->trapframe = 0;
+  // Usually called from the parent's kwait(), so uvmunmap() leaves
+  // p's resident set alone; drop it here.
+  free_resident_set(p);
   if(p->pagetable)
     proc_freepagetable(p->pagetable, p->sz);
   p->pagetable = 0;
@@ -214,6 +323,9 @@ freeproc(struct proc *p)
   p->chan = 0;
   p->killed = 0;
   p->xstate = 0;
+  if(p->deactivate)
+    panic("freeproc: deactivated");  // kexit() clears it
+  p->exiting = 0;
   p->state = UNUSED;
   
   // Clean up executable inode
@@ -244,6 +356,13 @@ freeproc(struct proc *p)
     p->swap_inode = 0;
   }
   memset(p->swap_slots, 0, sizeof(p->swap_slots));
+
+  // Drop the saved mappings of a process that died swapped out
+  swapimg_free(p);
+  p->swapped_out = 0;
+  p->swap_busy = 0;
+  p->vmbusy = 0;
+  p->in_swapout = 0;
 }
 
 // Create a user page table for a given process, with no user memory,
@@ -317,7 +436,8 @@ userinit(void)
   
   p->cwd = namei("/");
 
-  p->state = RUNNABLE;
+  p->last_cpu = 0;
+  make_runnable(p);
 
   release(&p->lock);
 }
@@ -355,12 +475,17 @@ kfork(void)
     return -1;
   }
 
-  // Copy user memory from parent to child.
+  // Copy user memory from parent to child. The parent's mappings
+  // must stay put while uvmcopy() walks them, even if kalloc()
+  // sleeps.
+  p->vmbusy++;
   if(uvmcopy(p->pagetable, np->pagetable, p->sz) < 0){
+    p->vmbusy--;
     freeproc(np);
     release(&np->lock);
     return -1;
   }
+  p->vmbusy--;
   np->sz = p->sz;
 
   // copy saved user registers.
@@ -386,7 +511,8 @@ kfork(void)
   release(&wait_lock);
 
   acquire(&np->lock);
-  np->state = RUNNABLE;
+  np->last_cpu = cpuid();
+  make_runnable(np);
   release(&np->lock);
 
   return pid;
@@ -432,6 +558,9 @@ kexit(int status)
   end_op();
   p->cwd = 0;
 
+  pgtrace_exit(p);
+  loadctl_exit(p);
+
   acquire(&wait_lock);
 
   // Give any children to init.
@@ -524,28 +653,199 @@ scheduler(void)
     intr_on();
     intr_off();
 
-    int found = 0;
-    for(p = proc; p < &proc[NPROC]; p++) {
-      acquire(&p->lock);
-      if(p->state == RUNNABLE) {
-        // Switch to chosen process.  It is the process's job
-        // to release its lock and then reacquire it
-        // before jumping back to us.
-        p->state = RUNNING;
-        c->proc = p;
-        swtch(&c->context, &p->context);
-
-        // Process is done running for now.
-        // It should have changed its p->state before coming back.
-        c->proc = 0;
-        found = 1;
-      }
-      release(&p->lock);
-    }
-    if(found == 0) {
+    if((p = runq_pop(&runq[cpuid()])) == 0 && (p = runq_steal()) == 0) {
       // nothing to run; stop running on this core until an interrupt.
       asm volatile("wfi");
+      continue;
+    }
+
+    // Only this CPU can take p off RUNNABLE now, since
+    // it is off every run queue.
+    acquire(&p->lock);
+    if(p->state != RUNNABLE)
+      panic("scheduler: queued process not RUNNABLE");
+    // Switch to chosen process.  It is the process's job
+    // to release its lock and then reacquire it
+    // before jumping back to us.
+    p->state = RUNNING;
+    p->last_cpu = cpuid();
+    p->nsched++;
+    p->run_start = r_time();
+    c->proc = p;
+    swtch(&c->context, &p->context);
+
+    // Process is done running for now.
+    // It should have changed its p->state before coming back.
+    p->cputime += r_time() - p->run_start;
+    c->proc = 0;
+    release(&p->lock);
+  }
+}
+
+static uint64
+nfaults(struct proc *p)
+{
+  uint64 n = 0;
+
+  for(int i = 0; i < NFAULT; i++)
+    n += p->nfault[i];
+  return n;
+}
+
+// Move p to MLFQ level, with a fresh quantum.
+// Caller must hold p->lock.
+static void
+mlfq_setlevel(struct proc *p, int level)
+{
+  p->priority = level;
+  p->slice = 0;
+  p->level_faults = nfaults(p);
+}
+
+// Apply any boost p has missed. Caller must hold p->lock.
+static void
+mlfq_refresh(struct proc *p)
+{
+  if(p->mlfq_epoch != mlfq_epoch){
+    p->mlfq_epoch = mlfq_epoch;
+    mlfq_setlevel(p, 0);
+  }
+}
+
+// Put p at the tail of its level's list on the run queue of the
+// CPU it last ran on, unless swap-out is holding it back
+// (swapout_idle() queues it when done).
+// Caller must hold p->lock, with p RUNNABLE.
+static void
+runq_push(struct proc *p)
+{
+  struct runq *rq = &runq[p->last_cpu];
+  int level;
+
+  if(p->swap_busy)
+    return;
+  acquire(&rq->lock);
+  // under rq->lock, so that a concurrent mlfq_boost() either
+  // sees p queued or p sees the new epoch.
+  mlfq_refresh(p);
+  level = p->priority;
+  p->rq_next = 0;
+  if(rq->tail[level])
+    rq->tail[level]->rq_next = p;
+  else
+    rq->head[level] = p;
+  rq->tail[level] = p;
+  rq->n++;
+  release(&rq->lock);
+}
+
+// Take the process at the head of rq's highest non-empty
+// level, or return 0.
+static struct proc*
+runq_pop(struct runq *rq)
+{
+  struct proc *p = 0;
+
+  acquire(&rq->lock);
+  for(int level = 0; level < NMLFQ; level++){
+    if((p = rq->head[level]) != 0){
+      rq->head[level] = p->rq_next;
+      if(rq->head[level] == 0)
+        rq->tail[level] = 0;
+      rq->n--;
+      break;
+    }
+  }
+  release(&rq->lock);
+  return p;
+}
+
+// Highest level with a process waiting on rq, or NMLFQ if none.
+// Unlocked peek, used only to decide whether to yield early.
+static int
+runq_top(struct runq *rq)
+{
+  for(int level = 0; level < NMLFQ; level++)
+    if(rq->head[level])
+      return level;
+  return NMLFQ;
+}
+
+// Take a process from the longest run queue of another CPU,
+// or return 0 if they are all empty.
+static struct proc*
+runq_steal(void)
+{
+  struct runq *busiest = 0;
+  int me = cpuid(), most = 0;
+
+  // Unlocked peek: a stale length only makes a worse choice.
+  for(int i = 0; i < NCPU; i++){
+    if(i != me && runq[i].n > most){
+      most = runq[i].n;
+      busiest = &runq[i];
+    }
+  }
+  return busiest ? runq_pop(busiest) : 0;
+}
+
+// Mark p RUNNABLE and queue it. Caller must hold p->lock.
+void
+make_runnable(struct proc *p)
+{
+  p->state = RUNNABLE;
+  runq_push(p);
+}
+
+// Charge a timer tick to the running process p and demote it if
+// it has used up its quantum or faulted too much at its level.
+// Returns 1 if p should yield: its quantum is over, or a process
+// of a higher level is waiting on this CPU's run queue.
+// Called on timer interrupts, with interrupts off.
+int
+mlfq_tick(struct proc *p)
+{
+  int level, over = 0;
+
+  acquire(&p->lock);
+  mlfq_refresh(p);
+  if(++p->slice >= (1 << p->priority)){
+    // round-robin within the bottom level.
+    mlfq_setlevel(p, p->priority < NMLFQ-1 ? p->priority + 1 : p->priority);
+    over = 1;
+  } else if(MLFQ_FAULT_DEMOTE > 0 && p->priority < NMLFQ-1 &&
+            nfaults(p) - p->level_faults >= MLFQ_FAULT_DEMOTE){
+    // a paging storm: keep it from crowding out interactive work.
+    mlfq_setlevel(p, p->priority + 1);
+    p->nfault_demote++;
+    over = 1;
+  }
+  level = p->priority;
+  release(&p->lock);
+
+  return over || runq_top(&runq[cpuid()]) < level;
+}
+
+// Move every process back to MLFQ level 0, so that processes
+// stuck at low levels cannot starve. Called by clockintr() on
+// CPU 0 every MLFQ_BOOST ticks.
+void
+mlfq_boost(void)
+{
+  __sync_fetch_and_add(&mlfq_epoch, 1);
+  for(struct runq *rq = runq; rq < &runq[NCPU]; rq++){
+    acquire(&rq->lock);
+    for(int level = 1; level < NMLFQ; level++){
+      if(rq->head[level] == 0)
+        continue;
+      if(rq->tail[0])
+        rq->tail[0]->rq_next = rq->head[level];
+      else
+        rq->head[0] = rq->head[level];
+      rq->tail[0] = rq->tail[level];
+      rq->head[level] = rq->tail[level] = 0;
     }
+    release(&rq->lock);
   }
 }
 
@@ -582,7 +882,7 @@ yield(void)
 {
   struct proc *p = myproc();
   acquire(&p->lock);
-  p->state = RUNNABLE;
+  make_runnable(p);
   sched();
   release(&p->lock);
 }
@@ -619,58 +919,140 @@ forkret(void)
 
   // return to user space, mimicing usertrap()'s return.
   prepare_return();
-  uint64 satp = MAKE_SATP(p->pagetable);
+  uint64 satp = proc_satp(p);
   uint64 trampoline_userret = TRAMPOLINE + (userret - trampoline);
   ((void (*)(uint64))trampoline_userret)(satp);
 }
 
+static struct waitq*
+waitq_of(void *chan)
+{
+  return &waitq[(((uint64)chan * 0x9e3779b97f4a7c15UL) >> 32) % NWAITQ];
+}
+
+// Append p to wq. Caller must hold wq->lock.
+static void
+waitq_add(struct waitq *wq, struct proc *p)
+{
+  p->wq = wq;
+  p->wq_next = 0;
+  p->wq_prev = wq->tail;
+  if(wq->tail)
+    wq->tail->wq_next = p;
+  else
+    wq->head = p;
+  wq->tail = p;
+}
+
+// Unlink p from its wait queue. Caller must hold p->wq->lock.
+static void
+waitq_del(struct proc *p)
+{
+  struct waitq *wq = p->wq;
+
+  if(p->wq_prev)
+    p->wq_prev->wq_next = p->wq_next;
+  else
+    wq->head = p->wq_next;
+  if(p->wq_next)
+    p->wq_next->wq_prev = p->wq_prev;
+  else
+    wq->tail = p->wq_prev;
+  p->wq = 0;
+}
+
 // Sleep on channel chan, releasing condition lock lk.
 // Re-acquires lk when awakened.
 void
 sleep(void *chan, struct spinlock *lk)
 {
   struct proc *p = myproc();
+  struct waitq *wq = waitq_of(chan);
   
   // Must acquire p->lock in order to
   // change p->state and then call sched.
-  // Once we hold p->lock, we can be
-  // guaranteed that we won't miss any wakeup
-  // (wakeup locks p->lock),
-  // so it's okay to release lk.
+  // Once we are on chan's wait queue and hold
+  // p->lock, we can be guaranteed that we won't
+  // miss any wakeup (wakeup locks the wait queue,
+  // then p->lock), so it's okay to release lk.
 
+  acquire(&wq->lock);
   acquire(&p->lock);  //DOC: sleeplock1
+  p->chan = chan;
+  waitq_add(wq, p);
+  release(&wq->lock);
   release(lk);
 
   // Go to sleep.
-  p->chan = chan;
   p->state = SLEEPING;
+  p->sleep_since = ticks;
 
   sched();
 
   // Tidy up.
   p->chan = 0;
 
-  // Reacquire original lock.
+  // Blocked in paging I/O: I/O-bound as far as the MLFQ is
+  // concerned, so start a fresh quantum. Processes that fault
+  // heavily are still demoted by mlfq_tick().
+  if(p->pageio)
+    p->slice = 0;
+
   release(&p->lock);
+
+  // wakeup() dequeues the processes it wakes, kkill() does not.
+  if(p->wq){
+    acquire(&wq->lock);
+    if(p->wq)
+      waitq_del(p);
+    release(&wq->lock);
+  }
+
+  // Reacquire original lock.
   acquire(lk);
 }
 
+// Wake up to n processes (all, if n < 0) sleeping on channel
+// chan, longest sleeper first.
+static void
+wakeup_n(void *chan, int n)
+{
+  struct waitq *wq = waitq_of(chan);
+  struct proc *p, *next;
+
+  acquire(&wq->lock);
+  for(p = wq->head; p && n != 0; p = next) {
+    next = p->wq_next;
+    // p->chan may be changing under p->lock; this is only a hint.
+    if(p == myproc() || p->chan != chan)
+      continue;
+    acquire(&p->lock);
+    if(p->state == SLEEPING && p->chan == chan) {
+      waitq_del(p);
+      make_runnable(p);
+      n--;
+    }
+    release(&p->lock);
+  }
+  release(&wq->lock);
+}
+
 // Wake up all processes sleeping on channel chan.
 // Caller should hold the condition lock.
 void
 wakeup(void *chan)
 {
-  struct proc *p;
+  wakeup_n(chan, -1);
+}
 
-  for(p = proc; p < &proc[NPROC]; p++) {
-    if(p != myproc()){
-      acquire(&p->lock);
-      if(p->state == SLEEPING && p->chan == chan) {
-        p->state = RUNNABLE;
-      }
-      release(&p->lock);
-    }
-  }
+// Wake up one process sleeping on chan, for waiters that each
+// consume what they wait for. A woken process that leaves some
+// behind should pass the wakeup on with another wakeup_one().
+// Caller should hold the condition lock.
+void
+wakeup_one(void *chan)
+{
+  wakeup_n(chan, 1);
 }
 
 // Kill the process with the given pid.
@@ -687,7 +1069,7 @@ kkill(int pid)
       p->killed = 1;
       if(p->state == SLEEPING){
         // Wake process from sleep().
-        p->state = RUNNABLE;
+        make_runnable(p);
       }
       release(&p->lock);
       return 0;
@@ -748,8 +1130,10 @@ either_copyin(void *dst, int user_src, uint64 src, uint64 len)
 
 // Add a page to the resident set (FIFO queue).
 // Called when a page is successfully paged in.
+// slot is the swap slot the page was read from, kept as a swap-cache
+// entry while the page stays clean, or -1.
 void
-add_to_resident_set(struct proc *p, uint64 va, int seq_num)
+add_to_resident_set(struct proc *p, uint64 va, int seq_num, int slot)
 {
   struct resident_page *node = (struct resident_page*)kalloc();
   if(node == 0)
@@ -757,6 +1141,7 @@ add_to_resident_set(struct proc *p, uint64 va, int seq_num)
 
   node->va = va;
   node->fifo_seq_num = seq_num;
+  node->swap_slot = slot;
   node->next = 0;
 
   acquire(&p->lock);
@@ -769,6 +1154,7 @@ add_to_resident_set(struct proc *p, uint64 va, int seq_num)
     p->resident_set_tail->next = node;
     p->resident_set_tail = node;
   }
+  p->nresident++;
   release(&p->lock);
 }
 
@@ -792,6 +1178,7 @@ remove_from_resident_set(struct proc *p, uint64 va)
       if(p->resident_set_tail == curr) // It's the tail
         p->resident_set_tail = prev;
 
+      p->nresident--;
       break;
     }
     prev = curr;
@@ -799,8 +1186,48 @@ remove_from_resident_set(struct proc *p, uint64 va)
   }
   release(&p->lock);
 
-  if(curr)
+  if(curr) {
+    if(curr->swap_slot >= 0)
+      swap_slot_free(p, curr->swap_slot); // Drop the swap-cache entry
     kfree(curr); // Free the tracking node
+  }
+}
+
+// Free every node of the resident set of p, without touching the
+// pages or swap slots they describe. p->lock must be held, or p
+// must not be running.
+void
+free_resident_set(struct proc *p)
+{
+  struct resident_page *r = p->resident_set_head;
+
+  p->resident_set_head = 0;
+  p->resident_set_tail = 0;
+  p->nresident = 0;
+  while(r) {
+    struct resident_page *next = r->next;
+    kfree((void*)r);
+    r = next;
+  }
+}
+
+// Helper function to find the swap-cache slot of a resident page
+// Returns -1 if not found or the page has no copy on swap
+int
+find_slot_in_resident_set(struct proc *p, uint64 va)
+{
+  acquire(&p->lock);
+  struct resident_page *curr = p->resident_set_head;
+  while(curr) {
+    if(curr->va == va) {
+      int slot = curr->swap_slot;
+      release(&p->lock);
+      return slot;
+    }
+    curr = curr->next;
+  }
+  release(&p->lock);
+  return -1;
 }
 
 // Helper function to find the FIFO seq num for a resident page
@@ -822,27 +1249,222 @@ find_seq_in_resident_set(struct proc *p, uint64 va)
   return -1;
 }
 
-// Evict the oldest (FIFO) page from the process's resident set.
-// Called by kalloc when memory is full.
-// Returns 1 on success, 0 if process has no pages to evict.
+// Open (creating it on first use) the swap file /pgswpNNNNN of p.
+// The creation is logged in a transaction of its own, or inside the
+// caller's with log space reserved by log_reserve(): a nested
+// begin_op() could wait for log space that only the caller's own
+// end_op() would free.
+// Returns the inode, unlocked, or 0 if it could not be created.
+static struct inode*
+swapfile_open(struct proc *p)
+{
+  if(p->swap_inode == 0) {
+    int op = (myproc()->in_op == 0);
+    if(!op && !log_reserve())
+      return 0;
+    // Create the swap file on first write
+    char swapname[32];
+    swapname[0] = '/';
+    swapname[1] = 'p';
+    swapname[2] = 'g';
+    swapname[3] = 's';
+    swapname[4] = 'w';
+    swapname[5] = 'p';
+    
+    // Format the PID as 5 digits
+    int pid = p->pid;
+    swapname[10] = '0' + (pid % 10);
+    pid /= 10;
+    swapname[9] = '0' + (pid % 10);
+    pid /= 10;
+    swapname[8] = '0' + (pid % 10);
+    pid /= 10;
+    swapname[7] = '0' + (pid % 10);
+    pid /= 10;
+    swapname[6] = '0' + (pid % 10);
+    swapname[11] = '\0';
+    
+    if(op)
+      begin_op();
+    struct inode *sip = namei(swapname);
+    if(sip == 0) {
+      sip = create(swapname, T_FILE, 0, 0);
+      // create() returns locked inode, unlock it
+      if(sip) iunlock(sip);
+    } else {
+      // namei() returns unlocked inode, we need to lock it for later use
+      ilock(sip);
+      iunlock(sip); // unlock it
+    }
+    if(op)
+      end_op();
+    else
+      log_unreserve();
+    p->swap_inode = sip;
+  }
+  return p->swap_inode;
+}
+
+// Write the page at physical address pa to swap slot slot of the
+// locked swap file ip. The data bypasses the log (writei_direct());
+// growing the file logs its bitmap, index and inode blocks, in a
+// transaction of its own. Inside the caller's transaction, log space
+// for them is reserved on top of the caller's, or the file is not
+// grown if the log is too full. ip stays locked throughout, except
+// while waiting to begin a transaction, since begin_op() must not be
+// called with an inode locked. A fault must therefore not get here
+// while holding bufs outside a transaction: readi() pins its user
+// buffer for that reason.
+// Returns 0 on success, -1 on failure.
+static int
+swap_writei(struct inode *ip, int slot, uint64 pa)
+{
+  uint off = (uint64)slot * PGSIZE;
+  int n, op = 0, reserved = 0;
+
+  if(off + PGSIZE > ip->size){
+    if(myproc()->in_op == 0){
+      iunlock(ip);
+      begin_op();
+      ilock(ip);
+      op = 1;
+    } else if(log_reserve()){
+      reserved = 1;
+    } else {
+      return -1;
+    }
+  }
+  n = writei_direct(ip, pa, off, PGSIZE);
+  if(op){
+    iunlock(ip);
+    end_op();
+    ilock(ip);
+  }
+  if(reserved)
+    log_unreserve();
+  return n == PGSIZE ? 0 : -1;
+}
+
+// Write the page at physical address pa to swap slot slot of p.
+// Returns 0 on success, -1 on failure.
 int
-do_page_replacement(struct proc *p)
+swap_write_page(struct proc *p, int slot, uint64 pa)
+{
+  struct inode *ip;
+  int r;
+
+  if((ip = swapfile_open(p)) == 0)
+    return -1;
+  ilock(ip);
+  r = swap_writei(ip, slot, pa);
+  iunlock(ip);
+  return r;
+}
+
+// Read swap slot slot of p into the page at physical address pa.
+// Returns 0 on success, -1 on failure.
+int
+swap_read_page(struct proc *p, int slot, uint64 pa)
+{
+  int n;
+
+  if(p->swap_inode == 0)
+    return -1;
+  ilock(p->swap_inode);
+  n = readi(p->swap_inode, 0, pa, (uint64)slot * PGSIZE, PGSIZE);
+  iunlock(p->swap_inode);
+  return n == PGSIZE ? 0 : -1;
+}
+
+// Bring the swapped-out page at va back into memory and map it
+// with its original permissions. The PTE must have PTE_S set.
+// Returns the physical address of the page, or 0 on failure.
+uint64
+swapin_page(struct proc *p, uint64 va)
+{
+  pte_t *pte;
+  char *mem;
+  int slot;
+  uint64 perms;
+
+  va = PGROUNDDOWN(va);
+  pte = walk(p->pagetable, va, 0);
+  if(pte == 0 || (*pte & PTE_V) != 0 || (*pte & PTE_S) == 0)
+    return 0;
+  slot = PTE_SLOT(*pte);
+  perms = *pte & (PTE_R | PTE_W | PTE_X | PTE_U);
+
+  printf("[pid %d] SWAPIN va=0x%lx slot=%d\n", p->pid, va, slot);
+
+  p->vmbusy++;
+  if((mem = kalloc()) == 0) {
+    p->vmbusy--;
+    return 0;
+  }
+  if(swap_read_page(p, slot, (uint64)mem) < 0) {
+    kfree(mem);
+    p->vmbusy--;
+    return 0;
+  }
+  p->nswapin++;
+  vmstat_add(VM_SWAPIN, 1);
+
+  // kalloc() may have evicted other pages; look the PTE up again.
+  pte = walk(p->pagetable, va, 0);
+
+  // Map the new page with original perms. The slot is kept as a
+  // swap-cache entry: while PTE_D stays clear, eviction just points
+  // the PTE back at it instead of writing the page out again.
+  *pte = PA2PTE(mem) | perms | PTE_V | PTE_SC;
+  tlb_flush_page(p, va);
+
+  // Add to resident set (for FIFO replacement)
+  add_to_resident_set(p, va, p->fifo_seq_num, slot);
+  printf("[pid %d] RESIDENT va=0x%lx seq=%d\n", p->pid, va, p->fifo_seq_num);
+  p->fifo_seq_num++;
+  p->vmbusy--;
+  return (uint64)mem;
+}
+
+// Evict the oldest (FIFO) page from the process's resident set,
+// adding it to the TLB batch b for the caller to flush; the frame
+// is freed by that flush.
+// Returns 1 on success, 0 if process has no pages to evict or the
+// oldest could not be written to swap.
+static int
+evict_oldest(struct proc *p, struct tlbbatch *b)
 {
   struct resident_page *victim;
 
-  // 1. Find victim (head of list - oldest page)
+  struct resident_page *prev = 0;
+  int scanned = 1;
+
+  // 1. Find victim (oldest page not pinned by a user copy in progress)
   acquire(&p->lock);
   victim = p->resident_set_head;
+  while(victim && victim->va >= p->pin_lo && victim->va < p->pin_hi) {
+    prev = victim;
+    victim = victim->next;
+    scanned++;
+  }
+  vmstat_add(VM_SCAN, scanned);
   if(victim == 0) {
     // Process has no pages to evict
     release(&p->lock);
     return 0;
   }
+  p->vmbusy++;
 
   // 2. Remove victim from FIFO list
-  p->resident_set_head = victim->next;
-  if(p->resident_set_head == 0) // List is now empty
-    p->resident_set_tail = 0;
+  if(prev == 0)
+    p->resident_set_head = victim->next;
+  else
+    prev->next = victim->next;
+  if(p->resident_set_tail == victim)
+    p->resident_set_tail = prev;
+  p->nresident--;
+  p->nevicted++;
+  vmstat_add(VM_EVICT, 1);
 
   release(&p->lock);
 
@@ -856,11 +1478,40 @@ do_page_replacement(struct proc *p)
   if((*pte & PTE_V) == 0)
     panic("do_page_replacement: page not valid");
 
+  // The frame is freed only once b is flushed.
+  tlb_batch_add(b, victim->va);
+
   // 5. Decide whether to swap-out or discard
   int is_executable_backed = (victim->va < p->exe_end);
   int is_dirty = (*pte & PTE_D);
   
-  if(!is_dirty && is_executable_backed) {
+  if(victim->swap_slot >= 0) {
+    // --- 0. PAGE STILL HAS ITS SWAP SLOT (swap cache) ---
+    int slot = victim->swap_slot;
+    uint64 pa = PTE2PA(*pte);
+    uint64 perms = *pte & (PTE_R | PTE_W | PTE_X | PTE_U);
+
+    if(!is_dirty) {
+      // Unchanged since swap-in: the slot is still up to date.
+      printf("[pid %d] EVICT va=0x%lx state=clean\n", p->pid, victim->va);
+      printf("[pid %d] SWAPCACHE va=0x%lx slot=%d\n", p->pid, victim->va, slot);
+      *pte = SLOT_PTE(slot) | perms | PTE_S;
+    } else {
+      // Modified: rewrite it in place.
+      printf("[pid %d] EVICT va=0x%lx state=dirty\n", p->pid, victim->va);
+      printf("[pid %d] SWAPOUT va=0x%lx slot=%d\n", p->pid, victim->va, slot);
+      if(swap_write_page(p, slot, pa) == 0) {
+        *pte = SLOT_PTE(slot) | perms | PTE_S;
+        p->nswapout++;
+        vmstat_add(VM_SWAPOUT, 1);
+      } else {
+        printf("[pid %d] DISCARD va=0x%lx\n", p->pid, victim->va);
+        swap_slot_free(p, slot);
+        *pte = 0;
+      }
+    }
+    tlb_batch_free(b, pa);
+  } else if(!is_dirty && is_executable_backed) {
     // --- 1. HANDLE CLEAN, BACKED PAGE ---
     // We can just discard it. Demand paging will reload from exec.
     printf("[pid %d] EVICT va=0x%lx state=clean\n", p->pid, victim->va);
@@ -868,7 +1519,7 @@ do_page_replacement(struct proc *p)
     
     uint64 pa = PTE2PA(*pte);
     *pte = 0;
-    kfree((void*)pa);
+    tlb_batch_free(b, pa);
   } else {
     // --- 2. HANDLE DIRTY or NON-BACKED PAGE (Heap/Stack) ---
     // We must write this page to the swap file.
@@ -882,7 +1533,7 @@ do_page_replacement(struct proc *p)
       p->killed = 1;      // Terminate process
       uint64 pa = PTE2PA(*pte);
       *pte = 0;
-      kfree((void*)pa);
+      tlb_batch_free(b, pa);
     } else {
       // --- 2b. SWAP SLOT IS AVAILABLE ---
       uint64 pa = PTE2PA(*pte);
@@ -891,76 +1542,692 @@ do_page_replacement(struct proc *p)
       printf("[pid %d] EVICT va=0x%lx state=dirty\n", p->pid, victim->va);
       printf("[pid %d] SWAPOUT va=0x%lx slot=%d\n", p->pid, victim->va, slot);
       
-      // Lazily create swap file if needed
-      if(p->swap_inode == 0) {
-        // Create the swap file on first write
-        char swapname[32];
-        swapname[0] = '/';
-        swapname[1] = 'p';
-        swapname[2] = 'g';
-        swapname[3] = 's';
-        swapname[4] = 'w';
-        swapname[5] = 'p';
-        
-        // Format the PID as 5 digits
-        int pid = p->pid;
-        swapname[10] = '0' + (pid % 10);
-        pid /= 10;
-        swapname[9] = '0' + (pid % 10);
-        pid /= 10;
-        swapname[8] = '0' + (pid % 10);
-        pid /= 10;
-        swapname[7] = '0' + (pid % 10);
-        pid /= 10;
-        swapname[6] = '0' + (pid % 10);
-        swapname[11] = '\0';
-        
-        begin_op();
-        struct inode *sip = namei(swapname);
-        if(sip == 0) {
-          sip = create(swapname, T_FILE, 0, 0);
-          // create() returns locked inode, unlock it
-          if(sip) iunlock(sip);
-        } else {
-          // namei() returns unlocked inode, we need to lock it for later use
-          ilock(sip);
-          iunlock(sip); // unlock it
-        }
-        end_op();
-        p->swap_inode = sip;
-      }
-      
-      // Write the page to the swap file
-      if(p->swap_inode) {
-        ilock(p->swap_inode);
-        int n = writei(p->swap_inode, 0, pa, (uint64)slot * PGSIZE, PGSIZE);
-        iunlock(p->swap_inode);
-        
-        if(n != PGSIZE) {
-          // Write failed
-          printf("[pid %d] DISCARD va=0x%lx\n", p->pid, victim->va);
-          swap_slot_free(p, slot);
-          *pte = 0;
-          kfree((void*)pa);
-        } else {
-          // Update PTE: Mark as "Swapped", store slot, and original perms
-          *pte = SLOT_PTE(slot) | perms | PTE_S;
-          kfree((void*)pa);
-        }
+      if(swap_write_page(p, slot, pa) == 0) {
+        // Update PTE: Mark as "Swapped", store slot, and original perms
+        *pte = SLOT_PTE(slot) | perms | PTE_S;
+        p->nswapout++;
+        vmstat_add(VM_SWAPOUT, 1);
       } else {
-        // No swap file - just discard
-        printf("EVICT (NoSwapFile) %d\n", victim->fifo_seq_num);
+        // Not written: no swap file, no log space to grow it inside
+        // the caller's transaction, or a disk error. Keep the page.
         swap_slot_free(p, slot);
-        *pte = 0;
-        kfree((void*)pa);
+        goto keep;
       }
+      tlb_batch_free(b, pa);
     }
   }
 
   // 6. Free the tracking node
   kfree(victim);
+  p->vmbusy--;
 
   return 1; // Success
+
+ keep:
+  // Put the victim back as the youngest page; nothing was evicted.
+  acquire(&p->lock);
+  victim->next = 0;
+  if(p->resident_set_tail)
+    p->resident_set_tail->next = victim;
+  else
+    p->resident_set_head = victim;
+  p->resident_set_tail = victim;
+  p->nresident++;
+  p->nevicted--;
+  release(&p->lock);
+  p->vmbusy--;
+  return 0;
+}
+
+// Evict the oldest (FIFO) page from the process's resident set.
+// Called by kalloc when memory is full.
+// Returns 1 on success, 0 if process has no pages to evict.
+int
+do_page_replacement(struct proc *p)
+{
+  struct tlbbatch b;
+  int r;
+
+  tlb_batch_init(&b, p);
+  r = evict_oldest(p, &b);
+  tlb_batch_flush(&b);
+  return r;
+}
+
+// Allocate n consecutive free swap slots so that a whole process
+// image lands in one contiguous stretch of its swap file.
+// Returns the first slot, or -1 if there is no such run.
+static int
+swap_slot_alloc_run(struct proc *p, int n)
+{
+  int start = 0, len = 0;
+
+  for(int s = 0; s < 1024 && len < n; s++) {
+    if((p->swap_slots[s / 8] >> (s % 8)) & 1) {
+      start = s + 1;
+      len = 0;
+    } else {
+      len++;
+    }
+  }
+  if(n <= 0 || len < n)
+    return -1;
+  for(int s = start; s < start + n; s++)
+    p->swap_slots[s / 8] |= (1 << (s % 8));
+  return start;
+}
+
+// Free the chain of saved mappings of p, if any.
+static void
+swapimg_free(struct proc *p)
+{
+  struct swap_image *img;
+
+  while((img = p->swapimg) != 0) {
+    p->swapimg = img->next;
+    kfree((void*)img);
+  }
+}
+
+// Write the whole resident set of p to swap and release its frames
+// and user page-table pages, leaving p->swapimg to describe every
+// mapping for swapin_proc(). Resident pages go to one run of
+// consecutive slots, written under a single lock of the swap file;
+// pages that still have a swap-cache slot go back to it (and are only
+// written if dirty), and clean executable pages are simply dropped and
+// reloaded later.
+// Returns the number of frames freed, or -1 (with p untouched) on failure.
+static int
+swapout_image(struct proc *p)
+{
+  pagetable_t pagetable = p->pagetable;
+  struct swap_image *img, *head = 0, **tail = &head;
+  struct swap_ent *e;
+  struct resident_page *r;
+  struct inode *ip = 0;
+  struct pgwalk w;
+  struct tlbbatch b;
+  pte_t *pte;
+  uint64 va;
+  int n, nent = 0, nwrite = 0, first = -1, next, nresident, nswapped, nout = 0;
+
+  // Pass 0: count the mappings to save, and the pages to write.
+  pgwalk_init(&w, pagetable, 0, TRAPFRAME);
+  while((pte = pgwalk_next(&w, &va)) != 0) {
+    if(*pte & PTE_V) {
+      nent++;
+      if((*pte & PTE_SC) == 0 && (va >= p->exe_end || (*pte & PTE_D)))
+        nwrite++;
+    } else if(*pte & PTE_S) {
+      nent++;
+    }
+  }
+  if(nent == 0)
+    return -1;
+
+  // Room for the image, allocated before anything is changed.
+  for(n = 0; n < nent; n += SWAPIMG_NENT) {
+    if((img = (struct swap_image*)kalloc()) == 0) {
+      p->swapimg = head;
+      swapimg_free(p);
+      return -1;
+    }
+    img->next = 0;
+    img->n = 0;
+    *tail = img;
+    tail = &img->next;
+  }
+
+  if(nwrite > 0 && (first = swap_slot_alloc_run(p, nwrite)) < 0) {
+    p->swapimg = head;
+    swapimg_free(p);
+    return -1;
+  }
+  if(p->swap_inode || nwrite > 0) {
+    if((ip = swapfile_open(p)) == 0)
+      goto bad;
+    ilock(ip);
+  }
+
+  // Pass 1: record every mapping and write the resident pages out.
+  // The page table is left alone so that a failure can back out.
+  // Swap-cache pages come first, straight from the resident set;
+  // their slots pass from the resident set to the image.
+  img = head;
+  next = first;
+  nresident = 0;
+  nswapped = 0;
+  for(r = p->resident_set_head; r; r = r->next) {
+    if(r->swap_slot < 0)
+      continue;
+    pte = walk(pagetable, r->va, 0);
+    if(img->n == SWAPIMG_NENT)
+      img = img->next;
+    e = &img->ent[img->n++];
+    e->va = r->va;
+    e->slot = r->swap_slot;
+    e->perm = *pte & (PTE_R | PTE_W | PTE_X | PTE_U);
+    e->resident = 1;
+    nresident++;
+    if(*pte & PTE_D) {
+      if(swap_writei(ip, e->slot, PTE2PA(*pte)) < 0)
+        goto bad;
+      nout++;
+    }
+  }
+  pgwalk_init(&w, pagetable, 0, TRAPFRAME);
+  while((pte = pgwalk_next(&w, &va)) != 0) {
+    if((*pte & (PTE_V | PTE_S)) == 0 || (*pte & PTE_SC))
+      continue;
+    if(img->n == SWAPIMG_NENT)
+      img = img->next;
+    e = &img->ent[img->n++];
+    e->va = va;
+    e->perm = *pte & (PTE_R | PTE_W | PTE_X | PTE_U);
+    if((*pte & PTE_V) == 0) {
+      e->slot = PTE_SLOT(*pte);
+      e->resident = 0;
+      nswapped++;
+      continue;
+    }
+    e->resident = 1;
+    nresident++;
+    if(e->va < p->exe_end && (*pte & PTE_D) == 0) {
+      e->slot = -1;
+      continue;
+    }
+    e->slot = next++;
+    if(swap_writei(ip, e->slot, PTE2PA(*pte)) < 0)
+      goto bad;
+    nout++;
+  }
+  if(ip)
+    iunlock(ip);
+
+  // Pass 2: drop the frames and mappings, then the page-table pages.
+  tlb_batch_init(&b, p);
+  for(img = head; img; img = img->next) {
+    for(n = 0; n < img->n; n++) {
+      e = &img->ent[n];
+      pte = walk(pagetable, e->va, 0);
+      tlb_batch_add(&b, e->va);
+      if(*pte & PTE_V)
+        tlb_batch_free(&b, PTE2PA(*pte));
+      *pte = 0;
+    }
+  }
+  tlb_batch_flush(&b);
+  uvmprune(pagetable, TRAPFRAME);
+
+  // The cached slots now belong to the image, so this frees only the nodes.
+  acquire(&p->lock);
+  free_resident_set(p);
+  release(&p->lock);
+
+  p->swapimg = head;
+  p->swapped_out = 1;
+  p->nswapout += nout;
+  p->nevicted += nresident;
+  vmstat_add(VM_SWAPOUT, nout);
+  vmstat_add(VM_EVICT, nresident);
+  vmstat_add(VM_PROCSWAPOUT, 1);
+  printf("[pid %d] PROCSWAPOUT resident=%d swapped=%d\n", p->pid, nresident, nswapped);
+  return nresident;
+
+ bad:
+  if(ip)
+    iunlock(ip);
+  for(n = 0; n < nwrite; n++)
+    swap_slot_free(p, first + n);
+  p->swapimg = head;
+  swapimg_free(p);
+  return -1;
+}
+
+// Swap p out with swapout_image(), marked vmbusy throughout so that
+// swapout_idle() leaves it alone while the swap-file I/O sleeps.
+// When p swaps itself out (loadctl_suspend()), nothing else holds
+// it back.
+// p must not be running: either it is myproc() or p->swap_busy is set.
+// Not inside a transaction: growing the swap file by a whole image
+// would overflow the caller's MAXOPBLOCKS.
+// Returns the number of frames freed, or -1 (with p untouched) on failure.
+int
+swapout_proc(struct proc *p)
+{
+  int n;
+
+  if(p->swapped_out || p->vmbusy || myproc()->in_op)
+    return -1;
+  p->vmbusy++;
+  n = swapout_image(p);
+  p->vmbusy--;
+  return n;
+}
+
+// Undo swapout_proc() for the current process: re-create every
+// saved mapping as a swapped-out PTE, so that faults (or the copy
+// routines) bring pages back on demand. The pages that were resident
+// at swap-out stay listed in p->swapimg for swapin_prefetch().
+void
+swapin_proc(struct proc *p)
+{
+  struct swap_image *img;
+  struct swap_ent *e;
+  pte_t *pte;
+  int n;
+
+  p->swapped_out = 0;
+  p->vmbusy++;
+  for(img = p->swapimg; img; img = img->next) {
+    for(n = 0; n < img->n; n++) {
+      e = &img->ent[n];
+      if(e->slot < 0)
+        continue;
+      if((pte = walk(p->pagetable, e->va, 1)) == 0) {
+        // No memory for page tables; the process cannot go on.
+        swap_slot_free(p, e->slot);
+        setkilled(p);
+        continue;
+      }
+      *pte = SLOT_PTE(e->slot) | e->perm | PTE_S;
+    }
+  }
+  p->vmbusy--;
+}
+
+// Start reading the slots of up to n more resident pages of p's
+// swap image, from entry *i of *img on, into the buffer cache
+// without waiting. Advances (*img, *i) past them.
+// Returns the number of pages started.
+static int
+swapin_ahead(struct proc *p, struct swap_image **img, int *i, int n)
+{
+  struct swap_ent *e;
+  int started = 0;
+
+  if(p->swap_inode == 0)
+    return 0;
+  ilock(p->swap_inode);
+  while(*img && started < n) {
+    if(*i == (*img)->n) {
+      *img = (*img)->next;
+      *i = 0;
+      continue;
+    }
+    e = &(*img)->ent[(*i)++];
+    if(e->resident && e->slot >= 0) {
+      readi_ahead(p->swap_inode, (uint)e->slot * PGSIZE, PGSIZE);
+      started++;
+    }
+  }
+  iunlock(p->swap_inode);
+  return started;
+}
+
+// Read back the pages that were resident when the current process
+// was swapped out, on its way back to user space, so that it does
+// not fault its previous working set in one page at a time. The
+// slots were written as one sequential run, and are read ahead
+// SWAPIN_AHEAD pages at a time, so that the disk streams them while
+// they are mapped one by one.
+void
+swapin_prefetch(struct proc *p)
+{
+  struct swap_image *img, *aimg = p->swapimg;
+  struct swap_ent *e;
+  pte_t *pte;
+  int n, ai = 0, ahead = 0, prefetched = 0, lazy = 0;
+
+  for(img = p->swapimg; img; img = img->next) {
+    for(n = 0; n < img->n; n++) {
+      e = &img->ent[n];
+      if(!e->resident || killed(p)) {
+        lazy++;
+        continue;
+      }
+      if(e->slot >= 0) {
+        if(ahead <= SWAPIN_AHEAD / 2)
+          ahead += swapin_ahead(p, &aimg, &ai, SWAPIN_AHEAD - ahead);
+        if(ahead > 0)
+          ahead--;
+      }
+      pte = walk(p->pagetable, e->va, 0);
+      if(pte && (*pte & PTE_S) && (*pte & PTE_V) == 0) {
+        if(swapin_page(p, e->va))
+          prefetched++;
+      } else if(e->slot < 0 && (pte == 0 || *pte == 0)) {
+        if(vmfault(p->pagetable, e->va, 1))
+          prefetched++;
+      }
+    }
+  }
+  swapimg_free(p);
+  printf("[pid %d] PROCSWAPIN prefetched=%d lazy=%d\n", p->pid, prefetched, lazy);
+}
+
+// Called by kalloc() when memory is full: swap out the process that
+// has been asleep longest, if it has slept at least SWAPOUT_IDLE_TICKS.
+// Not while the caller is in a transaction (see swapout_proc()).
+// Returns 1 if frames were freed, 0 otherwise.
+int
+swapout_idle(void)
+{
+  struct proc *me = myproc();
+  struct proc *p, *victim = 0;
+  uint longest = 0;
+  int r;
+
+  if(me == 0 || me->in_swapout || me->in_op)
+    return 0;
+
+  for(p = proc; p < &proc[NPROC]; p++) {
+    if(p == me)
+      continue;
+    acquire(&p->lock);
+    if(p->state == SLEEPING && !p->swap_busy && !p->swapped_out &&
+       !p->in_swapout && p->vmbusy == 0 && p->nresident > 0 &&
+       ticks - p->sleep_since >= SWAPOUT_IDLE_TICKS &&
+       ticks - p->sleep_since > longest) {
+      longest = ticks - p->sleep_since;
+      victim = p;
+    }
+    release(&p->lock);
+  }
+  if(victim == 0)
+    return 0;
+
+  // Keep the scheduler off the victim while its memory is in flux,
+  // even if it is woken up meanwhile.
+  acquire(&victim->lock);
+  if(victim->state != SLEEPING || victim->swap_busy || victim->vmbusy) {
+    release(&victim->lock);
+    return 0;
+  }
+  victim->swap_busy = 1;
+  release(&victim->lock);
+
+  me->in_swapout = 1;
+  r = swapout_proc(victim);
+  me->in_swapout = 0;
+
+  acquire(&victim->lock);
+  victim->swap_busy = 0;
+  if(victim->state == RUNNABLE)
+    runq_push(victim);  // woken while being swapped out
+  release(&victim->lock);
+
+  return r > 0;
+}
+
+// Count a user page fault for thrashing detection.
+// swapin is non-zero if the fault had to read the page back from swap.
+void
+loadctl_fault(int swapin)
+{
+  __sync_fetch_and_add(&loadctl.faults, 1);
+  if(swapin)
+    __sync_fetch_and_add(&loadctl.swapins, 1);
+}
+
+// Choose the process to deactivate: the lowest MLFQ level, then
+// the biggest resident set, that is not init and not already
+// deactivated. Returns 0 unless
+// at least two processes compete for memory, since suspending the
+// only memory user cannot relieve anything.
+// Caller must hold loadctl.lock.
+static struct proc*
+loadctl_victim(void)
+{
+  struct proc *p, *victim = 0;
+  int competing = 0, most = 0, lowest = -1;
+
+  for(p = proc; p < &proc[NPROC]; p++){
+    if(p == initproc || p->deactivate || p->exiting)
+      continue;
+    acquire(&p->lock);
+    if((p->state == RUNNABLE || p->state == RUNNING || p->state == SLEEPING) &&
+       p->nresident > 0 && !p->killed){
+      competing++;
+      mlfq_refresh(p);
+      if(p->priority > lowest ||
+         (p->priority == lowest && p->nresident > most)){
+        lowest = p->priority;
+        most = p->nresident;
+        victim = p;
+      }
+    }
+    release(&p->lock);
+  }
+  return competing >= 2 ? victim : 0;
+}
+
+// Sample the paging rates once per THRASH_WINDOW ticks and
+// deactivate or reactivate one process accordingly.
+// Called by clockintr() on CPU 0.
+void
+loadctl_tick(void)
+{
+  struct proc *p, *oldest;
+
+  if(ticks - loadctl.window_start < THRASH_WINDOW)
+    return;
+
+  acquire(&loadctl.lock);
+  loadctl.window_start = ticks;
+  loadctl.fault_rate = __sync_lock_test_and_set(&loadctl.faults, 0);
+  loadctl.swapin_rate = __sync_lock_test_and_set(&loadctl.swapins, 0);
+
+  if(loadctl.fault_rate >= THRASH_FAULT_HIGH &&
+     loadctl.swapin_rate >= THRASH_SWAPIN_HIGH){
+    loadctl.thrashing = 1;
+    if((p = loadctl_victim()) != 0){
+      // p suspends itself on its next return to user space.
+      p->deactivate = 1;
+      p->deactivated_at = ticks;
+      loadctl.ndeactivated++;
+      loadctl.deactivations++;
+    }
+  } else if(loadctl.swapin_rate <= THRASH_SWAPIN_LOW){
+    if(loadctl.ndeactivated == 0){
+      loadctl.thrashing = 0;
+    } else {
+      // Pressure has dropped: let the longest-suspended process back in.
+      oldest = 0;
+      for(p = proc; p < &proc[NPROC]; p++)
+        if(p->deactivate && (oldest == 0 || p->deactivated_at < oldest->deactivated_at))
+          oldest = p;
+      if(oldest == 0)
+        panic("loadctl_tick: ndeactivated");
+      oldest->deactivate = 0;
+      loadctl.ndeactivated--;
+      loadctl.reactivations++;
+      wakeup(&oldest->deactivate);
+    }
+  }
+  release(&loadctl.lock);
+}
+
+// Suspend the current process on behalf of load control:
+// give back its resident pages, then sleep until loadctl_tick()
+// reactivates it. Called by usertrap() before returning to user space.
+void
+loadctl_suspend(void)
+{
+  struct proc *p = myproc();
+  struct tlbbatch b;
+  int n = 0;
+
+  if((n = swapout_proc(p)) < 0) {
+    // No room for a whole image; give the frames back one by one,
+    // with a single TLB shootdown at the end.
+    n = 0;
+    tlb_batch_init(&b, p);
+    while(evict_oldest(p, &b))
+      n++;
+    tlb_batch_flush(&b);
+  }
+  printf("[pid %d] DEACTIVATE evicted=%d\n", p->pid, n);
+
+  acquire(&loadctl.lock);
+  while(p->deactivate && !killed(p))
+    sleep(&p->deactivate, &loadctl.lock);
+  if(p->deactivate){
+    // Killed while suspended.
+    p->deactivate = 0;
+    loadctl.ndeactivated--;
+  }
+  release(&loadctl.lock);
+
+  printf("[pid %d] REACTIVATE\n", p->pid);
+}
+
+// Drop the deactivation of exiting process p, which may have been
+// flagged after its last trip through loadctl_suspend(), and keep
+// loadctl_tick() from flagging it again before it is a zombie.
+// Called by kexit().
+static void
+loadctl_exit(struct proc *p)
+{
+  acquire(&loadctl.lock);
+  p->exiting = 1;
+  if(p->deactivate){
+    p->deactivate = 0;
+    loadctl.ndeactivated--;
+  }
+  release(&loadctl.lock);
+}
+
+// Snapshot the load-control state for thrashstat().
+void
+loadctl_stat(struct thrash_stat *ts)
+{
+  acquire(&loadctl.lock);
+  ts->thrashing = loadctl.thrashing;
+  ts->num_deactivated = loadctl.ndeactivated;
+  ts->window = THRASH_WINDOW;
+  ts->fault_rate = loadctl.fault_rate;
+  ts->swapin_rate = loadctl.swapin_rate;
+  ts->deactivations = loadctl.deactivations;
+  ts->reactivations = loadctl.reactivations;
+  release(&loadctl.lock);
+}
+
+static void
+fault_hist_add(struct fault_hist *h, uint64 dt)
+{
+  int b = 0;
+
+  while(b < FHIST_NBUCKET-1 && (dt >> (b+1)) != 0)
+    b++;
+  h->count++;
+  h->total += dt;
+  if(dt > h->max)
+    h->max = dt;
+  h->bucket[b]++;
+}
+
+// Record that a page fault of class kind (FLAT_*) took dt
+// r_time() units, in p's histograms and the system-wide ones.
+void
+faultlat_record(struct proc *p, int kind, uint64 dt)
+{
+  fault_hist_add(&p->fstat.hist[kind], dt);
+  acquire(&faultlat.lock);
+  fault_hist_add(&faultlat.fs.hist[kind], dt);
+  release(&faultlat.lock);
+}
+
+// Copy the fault latency histograms of process pid, or of the
+// whole system if pid is 0, into *fs. Returns -1 if there is no
+// such process.
+int
+faultlat_stat(int pid, struct fault_stat *fs)
+{
+  struct proc *p;
+
+  if(pid == 0){
+    acquire(&faultlat.lock);
+    *fs = faultlat.fs;
+    release(&faultlat.lock);
+    return 0;
+  }
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      *fs = p->fstat;
+      release(&p->lock);
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// Fill si[0..n-1] with the scheduling state of live processes.
+// Returns the number of entries filled.
+int
+schedinfo(struct sched_info *si, int n)
+{
+  struct proc *p;
+  int got = 0;
+
+  for(p = proc; p < &proc[NPROC] && got < n; p++){
+    acquire(&p->lock);
+    if(p->state != UNUSED && p->state != USED){
+      mlfq_refresh(p);
+      si->pid = p->pid;
+      si->state = p->state;
+      si->priority = p->priority;
+      si->slice = p->slice;
+      si->cputime = p->cputime;
+      if(p->state == RUNNING)
+        si->cputime += r_time() - p->run_start;
+      si->nsched = p->nsched;
+      si->nfault_demote = p->nfault_demote;
+      safestrcpy(si->name, p->name, sizeof(si->name));
+      si++;
+      got++;
+    }
+    release(&p->lock);
+  }
+  return got;
+}
+
+// Count n events of kind idx (VM_*). The counters are per-CPU,
+// so this takes no lock; vmstat_get() sums them.
+void
+vmstat_add(int idx, uint64 n)
+{
+  push_off();
+  mycpu()->vmstat[idx] += n;
+  pop_off();
+}
+
+// Take a snapshot of the system-wide memory state.
+void
+vmstat_get(struct vm_stat *vs)
+{
+  struct proc *p;
+
+  memset(vs, 0, sizeof(*vs));
+  acquire(&tickslock);
+  vs->ticks = ticks;
+  release(&tickslock);
+  kmemstat(&vs->total_frames, &vs->free_frames);
+  for(int c = 0; c < NCPU; c++)
+    for(int i = 0; i < NVMSTAT; i++)
+      vs->count[i] += cpus[c].vmstat[i];
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->state != UNUSED){
+      vs->resident_pages += p->nresident;
+      for(int i = 0; i < sizeof(p->swap_slots); i++)
+        for(uchar b = p->swap_slots[i]; b; b &= b - 1)
+          vs->swap_slots++;
+    }
+    release(&p->lock);
+  }
 }
 
 // Print a process listing to console.  For debugging.
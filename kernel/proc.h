@@ -1,5 +1,7 @@
 // ############## LLM Generated Code Begins ##############
 
+#include "memstat.h"
+
 // Saved registers for kernel context switches.
 struct context {
   uint64 ra;
@@ -26,6 +28,8 @@ struct cpu {
   struct context context;     // swtch() here to enter scheduler().
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
+  uint64 asid_gen;            // ASID generation this CPU's TLB is clean for.
+  uint64 vmstat[NVMSTAT];     // This CPU's share of the VM_* counters.
 };
 
 extern struct cpu cpus[NCPU];
@@ -88,6 +92,24 @@ struct resident_page {
   struct resident_page *next;  // Next node in FIFO queue
   uint64 va;                   // Virtual address of the resident page
   int fifo_seq_num;            // The sequence number assigned when paged in
+  int swap_slot;               // Slot still holding a copy of the page, or -1
+};
+
+// One saved mapping of a process swapped out by swapout_proc().
+struct swap_ent {
+  uint64 va;                   // Virtual address of the page
+  int slot;                    // Swap slot holding the page contents
+  short perm;                  // PTE_R|PTE_W|PTE_X|PTE_U of the mapping
+  short resident;              // Was resident at swap-out, so prefetch it back
+};
+
+#define SWAPIMG_NENT 255       // swap_ent's in a one-page swap_image
+
+// Saved mappings of a swapped-out process, chained one page at a time.
+struct swap_image {
+  struct swap_image *next;
+  int n;                       // Entries used in ent[]
+  struct swap_ent ent[SWAPIMG_NENT];
 };
 
 // Per-process state
@@ -100,6 +122,24 @@ struct proc {
   int killed;                  // If non-zero, have been killed
   int xstate;                  // Exit status to be returned to parent's wait
   int pid;                     // Process ID
+  int last_cpu;                // CPU it last ran on; its run queue when RUNNABLE
+
+  // the run-queue lock must be held when using this:
+  struct proc *rq_next;        // Next process on the same run queue
+
+  // --- MLFQ SCHEDULING (p->lock) ---
+  int priority;                // Queue level, 0 is highest
+  int slice;                   // Ticks used of the quantum at this level
+  uint64 level_faults;         // Page faults taken when it entered this level
+  uint mlfq_epoch;             // Last boost it has taken part in
+  uint64 run_start;            // r_time() at which it was last dispatched
+  uint64 cputime;              // r_time() units spent running
+  uint64 nsched;               // Times dispatched by scheduler()
+  uint64 nfault_demote;        // Demotions for faulting, see MLFQ_FAULT_DEMOTE
+
+  // the wait-queue lock must be held when using these:
+  struct waitq *wq;            // Wait queue p is linked on, or 0
+  struct proc *wq_next, *wq_prev;
 
   // wait_lock must be held when using this:
   struct proc *parent;         // Parent process
@@ -120,10 +160,53 @@ struct proc {
   // --- RESIDENT SET PAGE REPLACEMENT ---
   struct resident_page *resident_set_head;  // Head of FIFO queue (oldest page)
   struct resident_page *resident_set_tail;  // Tail of FIFO queue (newest page)
+  int nresident;               // Number of pages on the resident set
+
+  // --- LOAD CONTROL (loadctl.lock must be held) ---
+  int deactivate;              // If non-zero, suspended to relieve thrashing
+  uint deactivated_at;         // Tick at which the process was deactivated
+  int exiting;                 // In kexit(): no longer a load-control victim
 
   // --- SWAP FILE SUPPORT ---
   struct inode *swap_inode;    // Swap file inode for this process
   char swap_slots[128];        // Bitmap: 1024 bits for swap slots (128 bytes)
+
+  // --- WHOLE-PROCESS SWAPPING ---
+  uint sleep_since;            // Tick at which the process last went to sleep
+  int vmbusy;                  // Non-zero while changing its own mappings
+  int swap_busy;               // Being swapped out by another process (p->lock)
+  int swapped_out;             // Resident set is on swap, described by swapimg
+  int in_swapout;              // Currently swapping out another process
+  int pageio;                  // Handling a page fault or swap-in prefetch
+  int in_op;                   // Nesting of begin_op() calls not yet ended
+  struct swap_image *swapimg;  // Saved mappings while swapped out
+
+  // --- USER COPIES ---
+  uint64 pin_lo, pin_hi;       // [pin_lo, pin_hi) may not be evicted
+
+  // --- PAGING COUNTERS (see memstat2) ---
+  uint64 nfault[4];            // Page faults taken, by FAULT_* cause (memstat.h)
+  uint64 nswapin;              // Pages read back from swap
+  uint64 nswapout;             // Pages written to swap
+  uint64 exec_bytes;           // Bytes read from the executable image
+  uint64 nevicted;             // Resident pages taken away by replacement
+  uint64 fault_time;           // r_time() units spent in page faults
+  struct fault_stat fstat;     // Fault latency histograms
+
+  // --- TLB ---
+  uint64 asid;                 // Address-space ID of pagetable in the TLB
+  uint64 asid_gen;             // Generation asid belongs to; 0 if none yet
+  uint64 tlb_stale;            // CPUs that must flush asid before running it
+};
+
+// Pages of one process whose PTEs changed, to be invalidated
+// together; see tlb.c.
+struct tlbbatch {
+  struct proc *p;              // Owner of the page table, or 0
+  int n;                       // Pages noted; > TLBBATCH_MAX means all
+  uint64 va[TLBBATCH_MAX];
+  int nfree;                   // Frames to free once the flush is done
+  uint64 freepa[TLBBATCH_MAX];
 };
 
 //############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -0,0 +1,132 @@
+//############## LLM Generated Code Begins ##############
+
+// Sampling profiler.
+//
+// While profiling is on, every timer interrupt records the
+// interrupted pc (kernel or user) and the current process into a
+// per-CPU buffer. profread() drains the buffers to user space,
+// where the prof tool symbolizes the samples.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+#include "memstat.h"
+
+struct profbuf {
+  struct spinlock lock;
+  uint r, w;          // samples read and written; w - r are buffered
+  uint dropped;       // samples lost because the buffer was full
+  struct prof_sample s[PROF_NSAMPLE];
+};
+
+static struct profbuf profbuf[NCPU];
+static volatile int prof_on;
+
+void
+profinit(void)
+{
+  for(int i = 0; i < NCPU; i++)
+    initlock(&profbuf[i].lock, "prof");
+}
+
+// Record a sample for the interrupted pc.
+// Called by clockintr() on every CPU, with interrupts off.
+void
+prof_tick(void)
+{
+  struct profbuf *pb;
+  struct prof_sample *s;
+  struct proc *p;
+
+  if(!prof_on)
+    return;
+  pb = &profbuf[cpuid()];
+  p = myproc();
+  acquire(&pb->lock);
+  if(pb->w - pb->r == PROF_NSAMPLE){
+    pb->dropped++;
+  } else {
+    s = &pb->s[pb->w++ % PROF_NSAMPLE];
+    s->pc = r_sepc();
+    s->cpu = cpuid();
+    s->flags = (r_sstatus() & SSTATUS_SPP) ? 0 : PROF_USER;
+    if(p){
+      s->pid = p->pid;
+      safestrcpy(s->name, p->name, sizeof(s->name));
+    } else {
+      s->pid = 0;
+      s->name[0] = 0;
+    }
+  }
+  release(&pb->lock);
+}
+
+// Discard any old samples and start sampling.
+void
+profstart(void)
+{
+  for(int i = 0; i < NCPU; i++){
+    acquire(&profbuf[i].lock);
+    profbuf[i].r = profbuf[i].w = 0;
+    profbuf[i].dropped = 0;
+    release(&profbuf[i].lock);
+  }
+  __sync_synchronize();
+  prof_on = 1;
+}
+
+// Stop sampling. The buffered samples can still be read.
+// Returns the number of samples that were dropped.
+int
+profstop(void)
+{
+  int dropped = 0;
+
+  prof_on = 0;
+  __sync_synchronize();
+  for(int i = 0; i < NCPU; i++){
+    acquire(&profbuf[i].lock);
+    dropped += profbuf[i].dropped;
+    release(&profbuf[i].lock);
+  }
+  return dropped;
+}
+
+// Move up to n buffered samples to user address dst.
+// Returns the number moved, or -1 on error.
+int
+profread(uint64 dst, int n)
+{
+  struct prof_sample *kbuf;
+  int chunk = PGSIZE / sizeof(struct prof_sample);
+  int total = 0;
+
+  if((kbuf = (struct prof_sample *)kalloc()) == 0)
+    return -1;
+  for(int i = 0; i < NCPU && total < n; i++){
+    struct profbuf *pb = &profbuf[i];
+    for(;;){
+      int k = 0;
+      acquire(&pb->lock);
+      while(k < chunk && total + k < n && pb->r != pb->w)
+        kbuf[k++] = pb->s[pb->r++ % PROF_NSAMPLE];
+      release(&pb->lock);
+      if(k == 0)
+        break;
+      if(copyout(myproc()->pagetable, dst + total * sizeof(struct prof_sample),
+                 (char *)kbuf, k * sizeof(struct prof_sample)) < 0){
+        kfree(kbuf);
+        return -1;
+      }
+      total += k;
+    }
+  }
+  kfree(kbuf);
+  return total;
+}
+
+//############## LLM Generated Code Ends ################
@@ -7,6 +7,63 @@
 #include "riscv.h"
 #include "proc.h"
 #include "defs.h"
+#include "memstat.h"
+
+#ifdef LOCKSTAT
+// Lock statistics are kept per lock name rather than per lock, so
+// that e.g. all the per-process locks add up under "proc". The
+// counters are shared by locks that different CPUs may hold at
+// once, so they are updated with atomic instructions.
+static struct lock_stat lockstats[NLOCKSTAT];
+static int nlockstats;
+static uint lockstats_busy;   // guards adding names; a spinlock can't
+
+// Find or add the statistics entry for name, or return 0 if the
+// table is full.
+static struct lock_stat*
+lockstat_find(char *name)
+{
+  struct lock_stat *ls = 0;
+
+  while(__sync_lock_test_and_set(&lockstats_busy, 1) != 0)
+    ;
+  for(int i = 0; i < nlockstats; i++)
+    if(strncmp(lockstats[i].name, name, sizeof(lockstats[i].name)) == 0){
+      ls = &lockstats[i];
+      break;
+    }
+  if(ls == 0 && nlockstats < NLOCKSTAT){
+    ls = &lockstats[nlockstats];
+    safestrcpy(ls->name, name, sizeof(ls->name));
+    __sync_synchronize();
+    nlockstats++;
+  }
+  __sync_lock_release(&lockstats_busy);
+  return ls;
+}
+
+// Copy the statistics of up to n lock names to ls, or reset them
+// all if ls is 0. Returns the number of entries copied.
+int
+lockstat_get(struct lock_stat *ls, int n)
+{
+  int i;
+
+  while(__sync_lock_test_and_set(&lockstats_busy, 1) != 0)
+    ;
+  for(i = 0; i < nlockstats && (ls == 0 || i < n); i++){
+    struct lock_stat *e = &lockstats[i];
+    if(ls == 0){
+      e->nacquire = e->ncontended = e->nspin = 0;
+      e->total_hold = e->max_hold = 0;
+    } else {
+      ls[i] = *e;
+    }
+  }
+  __sync_lock_release(&lockstats_busy);
+  return ls ? i : 0;
+}
+#endif
 
 void
 initlock(struct spinlock *lk, char *name)
@@ -14,6 +71,9 @@ initlock(struct spinlock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->cpu = 0;
+#ifdef LOCKSTAT
+  lk->stat = lockstat_find(name);
+#endif
 }
 
 // Acquire the lock.
@@ -29,8 +89,19 @@ acquire(struct spinlock *lk)
   //   a5 = 1
   //   s1 = &lk->locked
   //   amoswap.w.aq a5, a5, (s1)
+  // While spinning, carry out TLB shootdowns posted to this hart:
+  // with interrupts off it could not otherwise, and the hart
+  // waiting for it may be the one that holds lk.
+#ifdef LOCKSTAT
+  uint64 spins = 0;
+  while(__sync_lock_test_and_set(&lk->locked, 1) != 0){
+    spins++;
+    tlb_ipi();
+  }
+#else
   while(__sync_lock_test_and_set(&lk->locked, 1) != 0)
-    ;
+    tlb_ipi();
+#endif
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
@@ -40,6 +111,17 @@ acquire(struct spinlock *lk)
 
   // Record info about lock acquisition for holding() and debugging.
   lk->cpu = mycpu();
+
+#ifdef LOCKSTAT
+  if(lk->stat){
+    __sync_fetch_and_add(&lk->stat->nacquire, 1);
+    if(spins){
+      __sync_fetch_and_add(&lk->stat->ncontended, 1);
+      __sync_fetch_and_add(&lk->stat->nspin, spins);
+    }
+    lk->t_acquired = r_time();
+  }
+#endif
 }
 
 // Release the lock.
@@ -51,6 +133,17 @@ release(struct spinlock *lk)
 
   lk->cpu = 0;
 
+#ifdef LOCKSTAT
+  if(lk->stat){
+    uint64 held = r_time() - lk->t_acquired;
+    uint64 max;
+    __sync_fetch_and_add(&lk->stat->total_hold, held);
+    while(held > (max = lk->stat->max_hold) &&
+          !__sync_bool_compare_and_swap(&lk->stat->max_hold, max, held))
+      ;
+  }
+#endif
+
   // Tell the C compiler and the CPU to not move loads or stores
   // past this point, to ensure that all the stores in the critical
   // section are visible to other CPUs before the lock is released,
@@ -5,5 +5,10 @@ struct spinlock {
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
+
+#ifdef LOCKSTAT
+  struct lock_stat *stat;  // Counters shared by all locks of this name.
+  uint64 t_acquired;       // r_time() when the lock was acquired.
+#endif
 };
 
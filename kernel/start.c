@@ -6,10 +6,14 @@
 
 void main();
 void timerinit();
+void ipiinit();
 
 // entry.S needs one stack per CPU.
 __attribute__ ((aligned (16))) char stack0[4096 * NCPU];
 
+// scratch space for ipivec in kernelvec.S, two words per CPU.
+uint64 ipiscratch[2 * NCPU];
+
 // entry.S jumps here in machine mode on stack0.
 void
 start()
@@ -30,7 +34,7 @@ start()
   // delegate all interrupts and exceptions to supervisor mode.
   w_medeleg(0xffff);
   w_mideleg(0xffff);
-  w_sie(r_sie() | SIE_SEIE | SIE_STIE);
+  w_sie(r_sie() | SIE_SEIE | SIE_STIE | SIE_SSIE);
 
   // configure Physical Memory Protection to give supervisor mode
   // access to all of physical memory.
@@ -40,6 +44,9 @@ start()
   // ask for clock interrupts.
   timerinit();
 
+  // take IPIs from other harts.
+  ipiinit();
+
   // keep each CPU's hartid in its tp register, for cpuid().
   int id = r_mhartid();
   w_tp(id);
@@ -64,3 +71,16 @@ timerinit()
   // ask for the very first timer interrupt.
   w_stimecmp(r_time() + 1000000);
 }
+
+// let other harts interrupt this one through its CLINT MSIP register.
+// the machine-mode interrupt can't be delegated, so ipivec in
+// kernelvec.S turns it into a supervisor software interrupt.
+void
+ipiinit()
+{
+  extern void ipivec();
+
+  w_mscratch((uint64)&ipiscratch[2 * r_mhartid()]);
+  w_mtvec((uint64)ipivec);
+  w_mie(r_mie() | MIE_MSIE);
+}
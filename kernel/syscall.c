@@ -102,6 +102,17 @@ extern uint64 sys_link(void);
 extern uint64 sys_mkdir(void);
 extern uint64 sys_close(void);
 extern uint64 sys_memstat(void);
+extern uint64 sys_thrashstat(void);
+extern uint64 sys_memstat2(void);
+extern uint64 sys_faultstat(void);
+extern uint64 sys_vmstat(void);
+extern uint64 sys_profstart(void);
+extern uint64 sys_profstop(void);
+extern uint64 sys_profread(void);
+extern uint64 sys_lockstat(void);
+extern uint64 sys_pgtrace(void);
+extern uint64 sys_pgtraceread(void);
+extern uint64 sys_schedinfo(void);
 
 // An array mapping syscall numbers from syscall.h
 // to the function that handles the system call.
@@ -128,6 +139,17 @@ static uint64 (*syscalls[])(void) = {
 [SYS_mkdir]   sys_mkdir,
 [SYS_close]   sys_close,
 [SYS_memstat] sys_memstat,
+[SYS_thrashstat] sys_thrashstat,
+[SYS_memstat2] sys_memstat2,
+[SYS_faultstat] sys_faultstat,
+[SYS_vmstat] sys_vmstat,
+[SYS_profstart] sys_profstart,
+[SYS_profstop] sys_profstop,
+[SYS_profread] sys_profread,
+[SYS_lockstat] sys_lockstat,
+[SYS_pgtrace] sys_pgtrace,
+[SYS_pgtraceread] sys_pgtraceread,
+[SYS_schedinfo] sys_schedinfo,
 };
 
 void
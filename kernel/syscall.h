@@ -21,3 +21,14 @@
 #define SYS_mkdir  20
 #define SYS_close  21
 #define SYS_memstat 22
+#define SYS_thrashstat 23
+#define SYS_memstat2 24
+#define SYS_faultstat 25
+#define SYS_vmstat 26
+#define SYS_profstart 27
+#define SYS_profstop 28
+#define SYS_profread 29
+#define SYS_lockstat 30
+#define SYS_pgtrace 31
+#define SYS_pgtraceread 32
+#define SYS_schedinfo 33
@@ -125,25 +125,35 @@ sys_memstat(void)
   k_info.next_fifo_seq = p->fifo_seq_num;
   k_info.num_pages_total = p->sz / PGSIZE;
 
-  // 3. Loop through the process's virtual memory
+  // 3. Every reported page starts out UNMAPPED
+  // (e.g., allocated by sbrk but never faulted)
   int page_count = 0;
   for(uint64 va = 0; va < p->sz && page_count < MAX_PAGES_INFO; va += PGSIZE) {
     struct page_stat *ps = &k_info.pages[page_count];
-    pte_t *pte = walk(p->pagetable, va, 0);
-
     ps->va = va;
+    ps->state = UNMAPPED;
+    ps->is_dirty = 0;
     ps->seq = -1;       // Default
     ps->swap_slot = -1; // Default
+    page_count++;
+  }
+
+  // 4. Walk only the parts of the page table that exist
+  struct pgwalk w;
+  pte_t *pte;
+  uint64 va;
+  pgwalk_init(&w, p->pagetable, 0, (uint64)page_count * PGSIZE);
+  while((pte = pgwalk_next(&w, &va)) != 0) {
+    struct page_stat *ps = &k_info.pages[va / PGSIZE];
 
-    if(pte == 0) {
-      // Page not in page table at all
-      ps->state = UNMAPPED;
-    } else if((*pte & PTE_V) != 0) {
+    if((*pte & PTE_V) != 0) {
       // --- Page is RESIDENT ---
       ps->state = RESIDENT;
       k_info.num_resident_pages++;
       ps->is_dirty = (*pte & PTE_D) ? 1 : 0;
       ps->seq = find_seq_in_resident_set(p, va);
+      if(*pte & PTE_SC)
+        ps->swap_slot = find_slot_in_resident_set(p, va); // swap-cache copy
 
     } else if((*pte & PTE_S) != 0) {
       // --- Page is SWAPPED ---
@@ -151,18 +161,10 @@ sys_memstat(void)
       k_info.num_swapped_pages++;
       ps->is_dirty = 0; // Not resident, so not dirty in RAM
       ps->swap_slot = PTE_SLOT(*pte);
-
-    } else {
-      // --- Page is UNMAPPED ---
-      // (e.g., allocated by sbrk but never faulted)
-      ps->state = UNMAPPED;
-      ps->is_dirty = 0;
     }
-
-    page_count++;
   }
 
-  // 4. Copy the completed kernel struct back to user space
+  // 5. Copy the completed kernel struct back to user space
   if(copyout(p->pagetable, user_info_ptr, (char *)&k_info, sizeof(k_info)) < 0) {
     return -1;
   }
@@ -170,5 +172,281 @@ sys_memstat(void)
   return 0;
 }
 
+// Fill in the FIFO seq and swap-cache slot of the resident pages
+// among ps[0..n-1], which are sorted by va. One pass over the
+// resident set per call, instead of one pass per page.
+static void
+memstat2_fill(struct proc *p, struct page_stat2 *ps, int n)
+{
+  struct resident_page *rp;
+
+  for(rp = p->resident_set_head; rp; rp = rp->next){
+    int lo = 0, hi = n - 1;
+    while(lo <= hi){
+      int mid = (lo + hi) / 2;
+      if(ps[mid].va == rp->va){
+        if(ps[mid].state == RESIDENT){
+          ps[mid].seq = rp->fifo_seq_num;
+          ps[mid].swap_slot = rp->swap_slot;
+        }
+        break;
+      }
+      if(ps[mid].va < rp->va)
+        lo = mid + 1;
+      else
+        hi = mid - 1;
+    }
+  }
+}
+
+// memstat2(start, buf, cap, stat): report up to cap resident or
+// swapped-out pages at or above start, plus the process counters.
+// Returns the va to pass as start to continue the listing, or
+// TRAPFRAME once the whole address space has been reported.
+uint64
+sys_memstat2(void)
+{
+  uint64 start, ubuf, ustat;
+  int cap;
+  struct proc *p = myproc();
+  struct proc_vm_stat st;
+  struct page_stat2 *kbuf;
+  int nchunk = PGSIZE / sizeof(struct page_stat2);
+
+  argaddr(0, &start);
+  argaddr(1, &ubuf);
+  argint(2, &cap);
+  argaddr(3, &ustat);
+  if(cap < 0)
+    return -1;
+  start = PGROUNDDOWN(start);
+  if(start > TRAPFRAME)
+    start = TRAPFRAME;
+
+  memset(&st, 0, sizeof(st));
+  st.pid = p->pid;
+  st.sz = p->sz;
+  st.num_resident_pages = p->nresident;
+  st.next_fifo_seq = p->fifo_seq_num;
+  for(int i = 0; i < NFAULT; i++)
+    st.faults[i] = p->nfault[i];
+  st.swapins = p->nswapin;
+  st.swapouts = p->nswapout;
+  st.exec_bytes = p->exec_bytes;
+  st.evictions = p->nevicted;
+  st.fault_time = p->fault_time;
+  for(int i = 0; i < sizeof(p->swap_slots); i++)
+    for(uchar b = p->swap_slots[i]; b; b &= b - 1)
+      st.num_swap_slots++;
+
+  if((kbuf = (struct page_stat2 *)kalloc()) == 0)
+    return -1;
+
+  // Walk a chunk at a time into kbuf, then copy it out. The copy may
+  // fault pages in and evict others, so the walk is restarted from
+  // the cursor after each chunk rather than carried across it.
+  uint64 next = start;
+  while(next < TRAPFRAME && st.npages < cap){
+    struct pgwalk w;
+    pte_t *pte;
+    uint64 va;
+    int n = 0, want = cap - st.npages;
+    if(want > nchunk)
+      want = nchunk;
+
+    pgwalk_init(&w, p->pagetable, next, TRAPFRAME);
+    next = TRAPFRAME;
+    while(n < want && (pte = pgwalk_next(&w, &va)) != 0){
+      struct page_stat2 *ps = &kbuf[n];
+      ps->va = va;
+      ps->seq = -1;
+      ps->swap_slot = -1;
+      if(*pte & PTE_V){
+        ps->state = RESIDENT;
+        ps->is_dirty = (*pte & PTE_D) ? 1 : 0;
+      } else if(*pte & PTE_S){
+        ps->state = SWAPPED;
+        ps->is_dirty = 0;
+        ps->swap_slot = PTE_SLOT(*pte);
+      } else {
+        continue;
+      }
+      n++;
+    }
+    if(n == want)
+      next = w.va;
+    memstat2_fill(p, kbuf, n);
+
+    if(copyout(p->pagetable, ubuf + st.npages * sizeof(struct page_stat2),
+               (char *)kbuf, n * sizeof(struct page_stat2)) < 0){
+      kfree(kbuf);
+      return -1;
+    }
+    st.npages += n;
+  }
+  kfree(kbuf);
+
+  if(copyout(p->pagetable, ustat, (char *)&st, sizeof(st)) < 0)
+    return -1;
+  return next;
+}
+
+uint64
+sys_thrashstat(void)
+{
+  uint64 addr;
+  struct thrash_stat ts;
+
+  argaddr(0, &addr);
+  loadctl_stat(&ts);
+  if(copyout(myproc()->pagetable, addr, (char *)&ts, sizeof(ts)) < 0)
+    return -1;
+  return 0;
+}
+
+// faultstat(pid, fs): page-fault latency histograms of process
+// pid, or system-wide ones if pid is 0.
+uint64
+sys_faultstat(void)
+{
+  int pid;
+  uint64 addr;
+  struct fault_stat fs;
+
+  argint(0, &pid);
+  argaddr(1, &addr);
+  if(faultlat_stat(pid, &fs) < 0)
+    return -1;
+  if(copyout(myproc()->pagetable, addr, (char *)&fs, sizeof(fs)) < 0)
+    return -1;
+  return 0;
+}
+
+uint64
+sys_vmstat(void)
+{
+  uint64 addr;
+  struct vm_stat vs;
+
+  argaddr(0, &addr);
+  vmstat_get(&vs);
+  if(copyout(myproc()->pagetable, addr, (char *)&vs, sizeof(vs)) < 0)
+    return -1;
+  return 0;
+}
+
+uint64
+sys_profstart(void)
+{
+  profstart();
+  return 0;
+}
+
+// Returns the number of samples dropped because a buffer was full.
+uint64
+sys_profstop(void)
+{
+  return profstop();
+}
+
+uint64
+sys_profread(void)
+{
+  uint64 addr;
+  int n;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  if(n < 0)
+    return -1;
+  return profread(addr, n);
+}
+
+// lockstat(buf, n): copy the statistics of up to n lock names to
+// buf and return how many there were, or reset them all if buf is 0.
+uint64
+sys_lockstat(void)
+{
+#ifdef LOCKSTAT
+  uint64 addr;
+  int n, got;
+  struct lock_stat *kbuf;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  if(addr == 0)
+    return lockstat_get(0, 0);
+  if(n < 0)
+    return -1;
+  if(n > NLOCKSTAT)
+    n = NLOCKSTAT;
+  if(n * sizeof(struct lock_stat) > PGSIZE)
+    n = PGSIZE / sizeof(struct lock_stat);
+  if((kbuf = (struct lock_stat *)kalloc()) == 0)
+    return -1;
+  got = lockstat_get(kbuf, n);
+  if(copyout(myproc()->pagetable, addr, (char *)kbuf, got * sizeof(struct lock_stat)) < 0)
+    got = -1;
+  kfree(kbuf);
+  return got;
+#else
+  return -1;  // kernel built without LOCKSTAT
+#endif
+}
+
+// pgtrace(pid, interval): trace the page references of pid, or
+// stop tracing if interval is 0. Returns the records the previous
+// trace dropped.
+uint64
+sys_pgtrace(void)
+{
+  int pid, interval;
+
+  argint(0, &pid);
+  argint(1, &interval);
+  if(interval < 0)
+    return -1;
+  return pgtrace_start(pid, interval);
+}
+
+uint64
+sys_pgtraceread(void)
+{
+  uint64 addr;
+  int n;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  if(n < 0)
+    return -1;
+  return pgtrace_read(addr, n);
+}
+
+// schedinfo(buf, n): copy the scheduling state of up to n live
+// processes to buf. Returns the number of entries copied.
+uint64
+sys_schedinfo(void)
+{
+  uint64 addr;
+  int n, got;
+  struct sched_info *kbuf;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  if(n < 0)
+    return -1;
+  if(n > NPROC)
+    n = NPROC;
+  if(n * sizeof(struct sched_info) > PGSIZE)
+    n = PGSIZE / sizeof(struct sched_info);
+  if((kbuf = (struct sched_info *)kalloc()) == 0)
+    return -1;
+  got = schedinfo(kbuf, n);
+  if(copyout(myproc()->pagetable, addr, (char *)kbuf, got * sizeof(struct sched_info)) < 0)
+    got = -1;
+  kfree(kbuf);
+  return got;
+}
+
 //############## LLM Generated Code Ends ################
 
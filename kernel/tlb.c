@@ -0,0 +1,167 @@
+//############## LLM Generated Code Begins ##############
+
+// TLB invalidation for user page tables.
+//
+// Callers collect the pages whose PTEs they changed in a tlbbatch and
+// flush it once. This hart drops just those pages. Other harts flush
+// the process's whole ASID lazily (p->tlb_stale, see proc_satp() in
+// vm.c) before they next run it. A hart that is running the process
+// right now gets an IPI through the CLINT instead, and the sender
+// waits until that hart has flushed.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+
+// A shootdown request posted to one hart.
+struct tlbmbox {
+  int busy;              // a sender owns this mailbox
+  volatile int pending;  // request posted and not yet carried out
+  uint64 asid;
+  int n;                 // pages in va[], or -1 for the whole ASID
+  uint64 va[TLBBATCH_MAX];
+} __attribute__ ((aligned (64)));
+
+static struct tlbmbox mbox[NCPU];
+
+// Carry out the request posted to this hart, if any.
+// Called from devintr() on a software interrupt, and by a hart that
+// spins for a mailbox or for an acknowledgement, so that two harts
+// shooting at each other cannot deadlock. Interrupts must be off.
+void
+tlb_ipi(void)
+{
+  struct tlbmbox *m = &mbox[cpuid()];
+
+  if(!m->pending)
+    return;
+  __sync_synchronize();
+  if(m->n < 0){
+    sfence_vma_asid(m->asid);
+  } else {
+    for(int i = 0; i < m->n; i++)
+      sfence_vma_va(m->va[i], m->asid);
+  }
+  __sync_synchronize();
+  m->pending = 0;
+}
+
+// Make hart flush the pages of b, and wait until it has.
+static void
+tlb_shoot(struct tlbbatch *b, int hart)
+{
+  struct tlbmbox *m = &mbox[hart];
+
+  while(__sync_lock_test_and_set(&m->busy, 1) != 0)
+    tlb_ipi();
+
+  m->asid = b->p->asid;
+  if(b->n > TLBBATCH_MAX){
+    m->n = -1;
+  } else {
+    m->n = b->n;
+    for(int i = 0; i < b->n; i++)
+      m->va[i] = b->va[i];
+  }
+  __sync_synchronize();
+  m->pending = 1;
+  *(volatile uint32 *)CLINT_MSIP(hart) = 1;
+
+  while(m->pending)
+    tlb_ipi();
+  __sync_lock_release(&m->busy);
+}
+
+// Start a batch of invalidations for the user page table of p.
+// p is 0 for a page table that no hart can have cached (exec's new
+// image, or one being freed, whose ASID is never reused without a
+// full flush), and its batch does nothing.
+void
+tlb_batch_init(struct tlbbatch *b, struct proc *p)
+{
+  b->p = p;
+  b->n = 0;
+  b->nfree = 0;
+}
+
+// Note that the PTE for va changed. Past TLBBATCH_MAX pages the
+// batch falls back to flushing the whole ASID.
+void
+tlb_batch_add(struct tlbbatch *b, uint64 va)
+{
+  if(b->n < TLBBATCH_MAX)
+    b->va[b->n] = PGROUNDDOWN(va);
+  if(b->n <= TLBBATCH_MAX)
+    b->n++;
+}
+
+// Invalidate the pages of b on every hart that may cache them.
+static void
+tlb_invalidate(struct tlbbatch *b)
+{
+  struct proc *p = b->p;
+  int me;
+
+  // A process that never got an ASID (or runs on hardware without
+  // them) is flushed wholesale by trampoline.S.
+  if(p == 0 || b->n == 0 || p->asid_gen == 0){
+    b->n = 0;
+    return;
+  }
+
+  push_off();
+  me = cpuid();
+  if(b->n > TLBBATCH_MAX){
+    sfence_vma_asid(p->asid);
+  } else {
+    for(int i = 0; i < b->n; i++)
+      sfence_vma_va(b->va[i], p->asid);
+  }
+  for(int h = 0; h < NCPU; h++){
+    if(h == me)
+      continue;
+    __sync_fetch_and_or(&p->tlb_stale, 1L << h);
+    if(cpus[h].proc == p)
+      tlb_shoot(b, h);
+  }
+  pop_off();
+  b->n = 0;
+}
+
+// Free the frame at pa once b has been flushed: until then another
+// hart may still write it through a stale TLB entry.
+void
+tlb_batch_free(struct tlbbatch *b, uint64 pa)
+{
+  if(b->nfree == TLBBATCH_MAX)
+    tlb_batch_flush(b);
+  b->freepa[b->nfree++] = pa;
+}
+
+// Invalidate the pages of b on every hart that may cache them,
+// then free the frames handed to tlb_batch_free().
+void
+tlb_batch_flush(struct tlbbatch *b)
+{
+  tlb_invalidate(b);
+  for(int i = 0; i < b->nfree; i++)
+    kfree((void*)b->freepa[i]);
+  b->nfree = 0;
+}
+
+// Invalidate a single page of p's page table.
+void
+tlb_flush_page(struct proc *p, uint64 va)
+{
+  struct tlbbatch b;
+
+  tlb_batch_init(&b, p);
+  tlb_batch_add(&b, va);
+  tlb_batch_flush(&b);
+}
+
+//############## LLM Generated Code Ends ################
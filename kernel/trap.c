@@ -7,6 +7,7 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "defs.h"
+#include "memstat.h"
 
 struct spinlock tickslock;
 uint ticks;
@@ -72,6 +73,11 @@ usertrap(void)
     // ok
   } else if((r_scause() == 12 || r_scause() == 13 || r_scause() == 15)) {
     // Page faults: 12=Instruction, 13=Load, 15=Store
+    uint64 fault_start = r_time();
+    p->pageio = 1;
+    uint64 evicted = p->nevicted;
+    int lat = -1;  // FLAT_* class, or -1 if not timed
+    vmstat_add(VM_PGFAULT, 1);
     uint64 va = r_stval();
     va = PGROUNDDOWN(va);
     uint64 *pte = walk(p->pagetable, va, 0);
@@ -84,52 +90,20 @@ usertrap(void)
     if(pte != 0 && (*pte & PTE_V) == 0 && (*pte & PTE_S) != 0) {
       // --- 1. HANDLE SWAP-IN ---
       printf("[pid %d] PAGEFAULT va=0x%lx access=%s cause=swap\n", p->pid, va, access_type);
+      loadctl_fault(1);
+      p->nfault[FAULT_SWAP]++;
+      lat = FLAT_SWAPIN;
       
-      int slot = PTE_SLOT(*pte);
-      uint64 perms = *pte & (PTE_R | PTE_W | PTE_X | PTE_U);
-
-      printf("[pid %d] SWAPIN va=0x%lx slot=%d\n", p->pid, va, slot);
-
-      char *mem = kalloc();
-      if(mem == 0) {
-        // kalloc failed - kill process
+      if(swapin_page(p, va) == 0) {
+        // No memory, or the swap file could not be read - kill process
         setkilled(p);
-      } else {
-        // Read page from swap file
-        if(p->swap_inode) {
-          ilock(p->swap_inode);
-          int n = readi(p->swap_inode, 0, (uint64)mem, (uint64)slot * PGSIZE, PGSIZE);
-          iunlock(p->swap_inode);
-          
-          if(n != PGSIZE) {
-            kfree(mem);
-            setkilled(p);
-          } else {
-            // Free the swap slot now that data is in memory
-            swap_slot_free(p, slot);
-
-            // Clear the old PTE (which was SLOT | PERMS | PTE_S)
-            *pte = 0;
-
-            // Map the new page with original perms
-            if(mappages(p->pagetable, va, PGSIZE, (uint64)mem, perms | PTE_V) != 0) {
-              kfree(mem);
-              setkilled(p);
-            } else {
-              // Add to resident set (for FIFO replacement)
-              add_to_resident_set(p, va, p->fifo_seq_num);
-              printf("[pid %d] RESIDENT va=0x%lx seq=%d\n", p->pid, va, p->fifo_seq_num);
-              p->fifo_seq_num++;
-            }
-          }
-        } else {
-          // No swap file - kill process
-          kfree(mem);
-          setkilled(p);
-        }
       }
-    } else if(pte == 0 || (*pte & PTE_V) != 0) {
+    } else if((pte == 0 && va >= p->sz &&
+               !(va < p->trapframe->sp && va >= p->trapframe->sp - PGSIZE)) ||
+              (pte != 0 && (*pte & PTE_V) != 0)) {
       // --- 2. INVALID ACCESS or PAGE ALREADY MAPPED ---
+      // (A missing leaf table inside the process is just a page
+      // that was never touched, or whose table was freed by swap-out.)
       printf("[pid %d] PAGEFAULT va=0x%lx access=%s cause=invalid\n", p->pid, va, access_type);
       printf("[pid %d] KILL invalid-access va=0x%lx access=%s\n", p->pid, va, access_type);
       setkilled(p);
@@ -137,38 +111,70 @@ usertrap(void)
       // --- 3. HANDLE REGULAR DEMAND PAGING (fresh page) ---
       // Determine cause
       char *cause = "heap";  // default
+      int kind = FAULT_HEAP;
       if(va >= p->exe_end && va < p->sz) {
         cause = "heap";
       } else if(va >= p->trapframe->sp && va < p->trapframe->sp + PGSIZE) {
         cause = "stack";
+        kind = FAULT_STACK;
       } else if(va < p->exe_end) {
         cause = "exec";
+        kind = FAULT_EXEC;
       }
       
       printf("[pid %d] PAGEFAULT va=0x%lx access=%s cause=%s\n", p->pid, va, access_type, cause);
+      loadctl_fault(0);
+      p->nfault[kind]++;
+      lat = (kind == FAULT_EXEC) ? FLAT_LOADEXEC : FLAT_ALLOC;
       
       // Page is not swapped and not mapped, do normal demand paging
       if(vmfault(p->pagetable, va, (r_scause() == 13)? 1 : 0) == 0) {
         setkilled(p);
       }
     }
+    p->pageio = 0;
+    uint64 dt = r_time() - fault_start;
+    p->fault_time += dt;
+    if(lat >= 0){
+      if(p->nevicted != evicted)
+        lat = FLAT_SWAPOUT;
+      faultlat_record(p, lat, dt);
+    }
   } else {
     printf("usertrap(): unexpected scause 0x%lx pid=%d\n", r_scause(), p->pid);
     printf("            sepc=0x%lx stval=0x%lx\n", r_sepc(), r_stval());
     setkilled(p);
   }
 
+  // load control may have picked this process to relieve thrashing.
+  if(p->deactivate)
+    loadctl_suspend();
+
   if(killed(p))
     kexit(-1);
 
-  // give up the CPU if this is a timer interrupt.
-  if(which_dev == 2)
-    yield();
+  // give up the CPU if this is a timer interrupt
+  // and the MLFQ says so.
+  if(which_dev == 2){
+    pgtrace_tick(p);
+    if(mlfq_tick(p))
+      yield();
+  }
+
+  // swapped out while asleep: put the mappings back, then
+  // fetch back the old working set.
+  if(p->swapped_out)
+    swapin_proc(p);
+  if(p->swapimg){
+    p->pageio = 1;
+    swapin_prefetch(p);
+    p->pageio = 0;
+  }
 
   prepare_return();
 
   // the user page table to switch to, for trampoline.S
-  uint64 satp = MAKE_SATP(p->pagetable);
+  uint64 satp = proc_satp(p);
 
   // return to trampoline.S; satp value in a0.
   return satp;
@@ -232,8 +238,9 @@ kerneltrap()
     panic("kerneltrap");
   }
 
-  // give up the CPU if this is a timer interrupt.
-  if(which_dev == 2 && myproc() != 0)
+  // give up the CPU if this is a timer interrupt
+  // and the MLFQ says so.
+  if(which_dev == 2 && myproc() != 0 && mlfq_tick(myproc()))
     yield();
 
   // the yield() may have caused some traps to occur,
@@ -250,8 +257,13 @@ clockintr()
     ticks++;
     wakeup(&ticks);
     release(&tickslock);
+    loadctl_tick();
+    if(ticks % MLFQ_BOOST == 0)
+      mlfq_boost();
   }
 
+  prof_tick();
+
   // ask for the next timer interrupt. this also clears
   // the interrupt request. 1000000 is about a tenth
   // of a second.
@@ -261,8 +273,11 @@ clockintr()
 // check if it's an external interrupt or software interrupt,
 // and handle it.
 // returns 2 if timer interrupt,
+// 3 if software interrupt (a TLB-shootdown IPI),
 // 1 if other device,
 // 0 if not recognized.
+// usertrap() and kerneltrap() only test for 0 (not a device) and
+// 2 (yield); 3 must stay non-zero and distinct from 2.
 int
 devintr()
 {
@@ -293,6 +308,12 @@ devintr()
     // timer interrupt.
     clockintr();
     return 2;
+  } else if(scause == 0x8000000000000001L){
+    // software interrupt: an IPI from another hart, forwarded
+    // by ipivec in kernelvec.S.
+    w_sip(r_sip() & ~2);
+    tlb_ipi();
+    return 3;
   } else {
     return 0;
   }
@@ -15,6 +15,7 @@
 #include "fs.h"
 #include "buf.h"
 #include "virtio.h"
+#include "memstat.h"
 
 // the address of virtio mmio register r.
 #define R(r) ((volatile uint32 *)(VIRTIO0 + (r)))
@@ -41,12 +42,14 @@ static struct disk {
   // our own book-keeping.
   char free[NUM];  // is a descriptor free?
   uint16 used_idx; // we've looked this far in used[2..NUM].
+  int unkicked;    // requests on the avail ring the device hasn't been told of.
 
   // track info about in-flight operations,
   // for use when completion interrupt arrives.
   // indexed by first descriptor index of chain.
   struct {
-    struct buf *b;
+    struct buf *b[SGBLOCKS]; // bufs of the adjacent blocks transferred
+    int n;
     char status;
   } info[NUM];
 
@@ -178,10 +181,20 @@ free_desc(int i)
   disk.desc[i].flags = 0;
   disk.desc[i].next = 0;
   disk.free[i] = 1;
-  wakeup(&disk.free[0]);
 }
 
-// free a chain of descriptors.
+// number of free descriptors.
+static int
+nfree_desc(void)
+{
+  int n = 0;
+  for(int i = 0; i < NUM; i++)
+    n += disk.free[i];
+  return n;
+}
+
+// free a chain of descriptors, and let one waiter in
+// virtio_disk_rw() try for it.
 static void
 free_chain(int i)
 {
@@ -194,14 +207,15 @@ free_chain(int i)
     else
       break;
   }
+  wakeup_one(&disk.free[0]);
 }
 
-// allocate three descriptors (they need not be contiguous).
-// disk transfers always use three descriptors.
+// allocate n descriptors (they need not be contiguous).
+// a disk transfer of k blocks uses k+2 descriptors.
 static int
-alloc3_desc(int *idx)
+alloc_descs(int *idx, int n)
 {
-  for(int i = 0; i < 3; i++){
+  for(int i = 0; i < n; i++){
     idx[i] = alloc_desc();
     if(idx[i] < 0){
       for(int j = 0; j < i; j++)
@@ -212,27 +226,70 @@ alloc3_desc(int *idx)
   return 0;
 }
 
+// tell the device about the requests added to the avail ring
+// since the last notification. caller must hold vdisk_lock.
+static void
+kick(void)
+{
+  if(disk.unkicked == 0)
+    return;
+  __sync_synchronize();
+  *R(VIRTIO_MMIO_QUEUE_NOTIFY) = 0; // value is queue number
+  disk.unkicked = 0;
+}
+
+// tell the device about queued requests that no one is
+// going to virtio_disk_wait() for.
 void
-virtio_disk_rw(struct buf *b, int write)
+virtio_disk_kick(void)
+{
+  acquire(&disk.vdisk_lock);
+  kick();
+  release(&disk.vdisk_lock);
+}
+
+// queue a read or write of the locked bufs b[0..n-1], which must
+// hold adjacent blocks, as one request, without waiting for it.
+// several requests may be queued and then waited for with
+// virtio_disk_wait(), which is also what tells the device about
+// them; until then, they cost only one notification between them.
+// the caller must not touch the bufs' data until the request is done.
+void
+virtio_disk_submit(struct buf **b, int n, int write)
 {
-  uint64 sector = b->blockno * (BSIZE / 512);
+  uint64 sector = b[0]->blockno * (BSIZE / 512);
 
+  if(n < 1 || n > SGBLOCKS)
+    panic("virtio_disk_submit");
+  for(int i = 1; i < n; i++)
+    if(b[i]->dev != b[0]->dev || b[i]->blockno != b[0]->blockno + i)
+      panic("virtio_disk_submit: blocks not adjacent");
+
+  vmstat_add(write ? VM_DISK_WRITE : VM_DISK_READ, n);
   acquire(&disk.vdisk_lock);
 
   // the spec's Section 5.2 says that legacy block operations use
-  // three descriptors: one for type/reserved/sector, one for the
-  // data, one for a 1-byte status result.
+  // a descriptor for type/reserved/sector, then data descriptors
+  // covering consecutive sectors, then one for a 1-byte status
+  // result. we use one data descriptor per buf.
 
-  // allocate the three descriptors.
-  int idx[3];
+  // allocate the descriptors.
+  int idx[SGBLOCKS+2];
+  int nd = n + 2;
   while(1){
-    if(alloc3_desc(idx) == 0) {
+    if(alloc_descs(idx, nd) == 0) {
       break;
     }
+    // the queue is full: make sure the device is working on it.
+    kick();
     sleep(&disk.free[0], &disk.vdisk_lock);
   }
+  // pass the wakeup on if there is room for another request
+  // of any size.
+  if(nfree_desc() >= SGBLOCKS + 2)
+    wakeup_one(&disk.free[0]);
 
-  // format the three descriptors.
+  // format the descriptors.
   // qemu's virtio-blk.c reads them.
 
   struct virtio_blk_req *buf0 = &disk.ops[idx[0]];
@@ -249,48 +306,70 @@ virtio_disk_rw(struct buf *b, int write)
   disk.desc[idx[0]].flags = VRING_DESC_F_NEXT;
   disk.desc[idx[0]].next = idx[1];
 
-  disk.desc[idx[1]].addr = (uint64) b->data;
-  disk.desc[idx[1]].len = BSIZE;
-  if(write)
-    disk.desc[idx[1]].flags = 0; // device reads b->data
-  else
-    disk.desc[idx[1]].flags = VRING_DESC_F_WRITE; // device writes b->data
-  disk.desc[idx[1]].flags |= VRING_DESC_F_NEXT;
-  disk.desc[idx[1]].next = idx[2];
+  for(int i = 0; i < n; i++){
+    int d = idx[i+1];
+    disk.desc[d].addr = (uint64) b[i]->data;
+    disk.desc[d].len = BSIZE;
+    if(write)
+      disk.desc[d].flags = 0; // device reads b->data
+    else
+      disk.desc[d].flags = VRING_DESC_F_WRITE; // device writes b->data
+    disk.desc[d].flags |= VRING_DESC_F_NEXT;
+    disk.desc[d].next = idx[i+2];
+  }
 
+  int st = idx[nd-1];
   disk.info[idx[0]].status = 0xff; // device writes 0 on success
-  disk.desc[idx[2]].addr = (uint64) &disk.info[idx[0]].status;
-  disk.desc[idx[2]].len = 1;
-  disk.desc[idx[2]].flags = VRING_DESC_F_WRITE; // device writes the status
-  disk.desc[idx[2]].next = 0;
-
-  // record struct buf for virtio_disk_intr().
-  b->disk = 1;
-  disk.info[idx[0]].b = b;
+  disk.desc[st].addr = (uint64) &disk.info[idx[0]].status;
+  disk.desc[st].len = 1;
+  disk.desc[st].flags = VRING_DESC_F_WRITE; // device writes the status
+  disk.desc[st].next = 0;
+
+  // record struct bufs for virtio_disk_intr().
+  for(int i = 0; i < n; i++){
+    b[i]->disk = 1;
+    disk.info[idx[0]].b[i] = b[i];
+  }
+  disk.info[idx[0]].n = n;
 
   // tell the device the first index in our chain of descriptors.
   disk.avail->ring[disk.avail->idx % NUM] = idx[0];
 
   __sync_synchronize();
 
-  // tell the device another avail ring entry is available.
+  // another avail ring entry is available, but the
+  // device only looks once kick() notifies it.
   disk.avail->idx += 1; // not % NUM ...
+  disk.unkicked += 1;
 
-  __sync_synchronize();
+  release(&disk.vdisk_lock);
+}
 
-  *R(VIRTIO_MMIO_QUEUE_NOTIFY) = 0; // value is queue number
+// wait for the request queued on b by virtio_disk_submit()
+// to finish; with several bufs in one request, waiting for
+// any of them is enough.
+void
+virtio_disk_wait(struct buf *b)
+{
+  acquire(&disk.vdisk_lock);
+  kick();
 
   // Wait for virtio_disk_intr() to say request has finished.
   while(b->disk == 1) {
     sleep(b, &disk.vdisk_lock);
   }
 
-  disk.info[idx[0]].b = 0;
-  free_chain(idx[0]);
-
   release(&disk.vdisk_lock);
 }
 
+// read or write b, and wait for it.
+void
+virtio_disk_rw(struct buf *b, int write)
+{
+  virtio_disk_submit(&b, 1, write);
+  virtio_disk_wait(b);
+}
+
 void
 virtio_disk_intr()
 {
@@ -316,9 +395,22 @@ virtio_disk_intr()
     if(disk.info[id].status != 0)
       panic("virtio_disk_intr status");
 
-    struct buf *b = disk.info[id].b;
-    b->disk = 0;   // disk is done with buf
-    wakeup(b);
+    for(int i = 0; i < disk.info[id].n; i++){
+      struct buf *b = disk.info[id].b[i];
+      disk.info[id].b[i] = 0;
+      b->disk = 0;   // disk is done with buf
+      if(b->async){
+        // no one waits for readahead; finish it here.
+        b->async = 0;
+        breadahead_done(b);
+      } else {
+        wakeup(b);
+      }
+    }
+
+    // the waiters may not come back for a while; recycle
+    // the descriptors now.
+    free_chain(id);
 
     disk.used_idx += 1;
   }
@@ -19,6 +19,17 @@ extern char etext[];  // kernel.ld sets this to end of kernel code.
 
 extern char trampoline[]; // trampoline.S
 
+// User address-space IDs. ASIDs are handed out in generations:
+// when they run out, a new generation starts and each CPU flushes
+// its whole TLB before running a process of the new generation.
+// ASID 0 is the kernel's, and means "none" if the hardware has no ASIDs.
+struct {
+  struct spinlock lock;
+  uint64 max;     // largest ASID the hardware supports
+  uint64 next;    // next free ASID of this generation
+  uint64 gen;     // current generation
+} asids;
+
 // Make a direct-map page table for the kernel.
 pagetable_t
 kvmmake(void)
@@ -37,6 +48,9 @@ kvmmake(void)
   // PLIC
   kvmmap(kpgtbl, PLIC, PLIC, 0x4000000, PTE_R | PTE_W);
 
+  // CLINT MSIP registers, to send IPIs.
+  kvmmap(kpgtbl, CLINT, CLINT, PGSIZE, PTE_R | PTE_W);
+
   // map kernel text executable and read-only.
   kvmmap(kpgtbl, KERNBASE, KERNBASE, (uint64)etext-KERNBASE, PTE_R | PTE_X);
 
@@ -68,6 +82,9 @@ void
 kvminit(void)
 {
   kernel_pagetable = kvmmake();
+  initlock(&asids.lock, "asid");
+  asids.next = 1;
+  asids.gen = 1;
 }
 
 // Switch the current CPU's h/w page table register to
@@ -78,12 +95,55 @@ kvminithart()
   // wait for any previous writes to the page table memory to finish.
   sfence_vma();
 
+  // find out how many ASID bits the hardware implements:
+  // the unimplemented ones read back as zero.
+  w_satp(MAKE_SATP(kernel_pagetable) | SATP_ASID_MASK);
+  asids.max = (r_satp() & SATP_ASID_MASK) >> SATP_ASID_SHIFT;
+
   w_satp(MAKE_SATP(kernel_pagetable));
 
   // flush stale entries from the TLB.
   sfence_vma();
 }
 
+// Return the satp value for returning p to user space on this CPU.
+// Gives p an ASID of the current generation if it has none, and
+// flushes what this CPU's TLB may still hold that is stale for it.
+// Called with interrupts off.
+uint64
+proc_satp(struct proc *p)
+{
+  struct cpu *c = mycpu();
+  uint64 me = 1L << cpuid();
+
+  if(asids.max == 0){
+    // No ASIDs: trampoline.S flushes on every switch.
+    return MAKE_SATP(p->pagetable);
+  }
+
+  acquire(&asids.lock);
+  if(p->asid_gen != asids.gen){
+    if(asids.next > asids.max){
+      asids.gen++;
+      asids.next = 1;
+    }
+    p->asid = asids.next++;
+    p->asid_gen = asids.gen;
+  }
+  release(&asids.lock);
+
+  if(c->asid_gen != p->asid_gen){
+    // ASIDs of older generations may have been handed out again.
+    sfence_vma();
+    c->asid_gen = p->asid_gen;
+  } else if(p->tlb_stale & me){
+    sfence_vma_asid(p->asid);
+  }
+  __sync_fetch_and_and(&p->tlb_stale, ~me);
+
+  return MAKE_SATP_ASID(p->pagetable, p->asid);
+}
+
 // Return the address of the PTE in page table pagetable
 // that corresponds to virtual address va.  If alloc!=0,
 // create any required page-table pages.
@@ -116,6 +176,52 @@ walk(pagetable_t pagetable, uint64 va, int alloc)
   return &pagetable[PX(0, va)];
 }
 
+// Start iterating over the leaf PTEs of pagetable for [va, end).
+void
+pgwalk_init(struct pgwalk *w, pagetable_t pagetable, uint64 va, uint64 end)
+{
+  w->pagetable = pagetable;
+  w->va = PGROUNDDOWN(va);
+  w->end = end > MAXVA ? MAXVA : end;
+  w->l0 = 0;
+}
+
+// Return the next non-zero leaf PTE (mapped, or swapped out) of the
+// range and set *va to its address, or return 0 at the end of the
+// range. The page-table tree is descended once per 2 MiB region and
+// absent level-2/level-1 entries are skipped wholesale, so sparse
+// address spaces are cheap to scan. The caller may change or clear
+// the PTEs it is given, but must not free page-table pages.
+pte_t *
+pgwalk_next(struct pgwalk *w, uint64 *va)
+{
+  pte_t *pte;
+
+  while(w->va < w->end){
+    if(w->l0 == 0){
+      pte = &w->pagetable[PX(2, w->va)];
+      if((*pte & PTE_V) == 0){
+        w->va = (w->va + (1L << PXSHIFT(2))) & ~((1L << PXSHIFT(2)) - 1);
+        continue;
+      }
+      pte = &((pagetable_t)PTE2PA(*pte))[PX(1, w->va)];
+      if((*pte & PTE_V) == 0){
+        w->va = (w->va + (1L << PXSHIFT(1))) & ~((1L << PXSHIFT(1)) - 1);
+        continue;
+      }
+      w->l0 = (pagetable_t)PTE2PA(*pte);
+    }
+    pte = &w->l0[PX(0, w->va)];
+    *va = w->va;
+    w->va += PGSIZE;
+    if(PX(0, w->va) == 0)
+      w->l0 = 0;  // on to the next leaf page-table page
+    if(*pte != 0)
+      return pte;
+  }
+  return 0;
+}
+
 // Look up a virtual address, return the physical address,
 // or 0 if not mapped.
 // Can only be used to look up user pages.
@@ -139,6 +245,21 @@ walkaddr(pagetable_t pagetable, uint64 va)
   return pa;
 }
 
+// The current process, if pagetable is its page table, or 0.
+// vm.c keeps the resident set, swap slots and TLB up to date only
+// for the current process's page table. Any other it is handed
+// (exec's new or old image, a child being copied or freed) is in
+// use on no hart. Code that changes a live process's page table
+// from outside (whole-process swap-out) does that bookkeeping
+// itself.
+static struct proc*
+vmowner(pagetable_t pagetable)
+{
+  struct proc *p = myproc();
+
+  return p != 0 && p->pagetable == pagetable ? p : 0;
+}
+
 // Create PTEs for virtual addresses starting at va that refer to
 // physical addresses starting at pa.
 // va and size MUST be page-aligned.
@@ -149,6 +270,7 @@ mappages(pagetable_t pagetable, uint64 va, uint64 size, uint64 pa, int perm)
 {
   uint64 a, last;
   pte_t *pte;
+  struct tlbbatch b;
 
   if((va % PGSIZE) != 0)
     panic("mappages: va not aligned");
@@ -159,6 +281,8 @@ mappages(pagetable_t pagetable, uint64 va, uint64 size, uint64 pa, int perm)
   if(size == 0)
     panic("mappages: size");
   
+  if(pagetable != kernel_pagetable)
+    tlb_batch_init(&b, vmowner(pagetable));
   a = va;
   last = va + size - PGSIZE;
   for(;;){
@@ -167,11 +291,16 @@ mappages(pagetable_t pagetable, uint64 va, uint64 size, uint64 pa, int perm)
     if(*pte & PTE_V)
       panic("mappages: remap");
     *pte = PA2PTE(pa) | perm | PTE_V;
+    if(pagetable != kernel_pagetable)
+      tlb_batch_add(&b, a);
     if(a == last)
       break;
     a += PGSIZE;
     pa += PGSIZE;
   }
+  // the TLB may remember that the pages were invalid.
+  if(pagetable != kernel_pagetable)
+    tlb_batch_flush(&b);
   return 0;
 }
 
@@ -191,20 +320,24 @@ uvmcreate()
 // Remove npages of mappings starting from va. va must be
 // page-aligned. It's OK if the mappings don't exist.
 // Optionally free the physical memory.
+// The resident set and swap slots are the current process's, and
+// are only updated for its own page table (see vmowner()).
 void
 uvmunmap(pagetable_t pagetable, uint64 va, uint64 npages, int do_free)
 {
+  struct pgwalk w;
+  struct tlbbatch b;
   uint64 a;
   pte_t *pte;
-  struct proc *p = myproc();
+  struct proc *p = vmowner(pagetable);
 
   if((va % PGSIZE) != 0)
     panic("uvmunmap: not aligned");
 
-  for(a = va; a < va + npages*PGSIZE; a += PGSIZE){
-    if((pte = walk(pagetable, a, 0)) == 0) // leaf page table entry allocated?
-      continue;   
-    
+  tlb_batch_init(&b, p);
+  pgwalk_init(&w, pagetable, va, va + npages*PGSIZE);
+  while((pte = pgwalk_next(&w, &a)) != 0){
+    tlb_batch_add(&b, a);
     // Check if page is on swap and free slot
     if((*pte & PTE_S) != 0 && (*pte & PTE_V) == 0) {
       int slot = PTE_SLOT(*pte);
@@ -213,20 +346,21 @@ uvmunmap(pagetable_t pagetable, uint64 va, uint64 npages, int do_free)
       }
     }
     
-    if((*pte & PTE_V) == 0)  // has physical page been allocated?
+    if((*pte & PTE_V) == 0) {  // has physical page been allocated?
+      *pte = 0;
       continue;
+    }
     
     // Remove from resident set before freeing
-    if(p && (*pte & PTE_V)) {
+    if(p) {
       remove_from_resident_set(p, a);
     }
     
-    if(do_free){
-      uint64 pa = PTE2PA(*pte);
-      kfree((void*)pa);
-    }
+    if(do_free)
+      tlb_batch_free(&b, PTE2PA(*pte));
     *pte = 0;
   }
+  tlb_batch_flush(&b);
 }
 
 // Allocate PTEs and physical memory to grow a process from oldsz to
@@ -295,13 +429,49 @@ freewalk(pagetable_t pagetable)
   kfree((void*)pagetable);
 }
 
+// Free the page-table pages below va end that no longer map anything,
+// after their leaf mappings (and swapped-out entries) have been zeroed.
+void
+uvmprune(pagetable_t pagetable, uint64 end)
+{
+  for(int i = 0; i < PX(2, end); i++){
+    pte_t pte = pagetable[i];
+    if((pte & PTE_V) == 0)
+      continue;
+    pagetable_t l1 = (pagetable_t)PTE2PA(pte);
+    int used1 = 0;
+    for(int j = 0; j < 512; j++){
+      if((l1[j] & PTE_V) == 0)
+        continue;
+      pagetable_t l0 = (pagetable_t)PTE2PA(l1[j]);
+      int used0 = 0;
+      for(int k = 0; k < 512; k++)
+        if(l0[k] != 0)
+          used0 = 1;
+      if(used0){
+        used1 = 1;
+      } else {
+        kfree((void*)l0);
+        l1[j] = 0;
+      }
+    }
+    if(!used1){
+      kfree((void*)l1);
+      pagetable[i] = 0;
+    }
+  }
+}
+
 // Free user memory pages,
 // then free page-table pages.
+// Stack pages grown below the stack pointer may lie above sz,
+// so everything up to the trapframe is unmapped; the range walk
+// makes the unused part of that free.
 void
 uvmfree(pagetable_t pagetable, uint64 sz)
 {
   if(sz > 0)
-    uvmunmap(pagetable, 0, PGROUNDUP(sz)/PGSIZE, 1);
+    uvmunmap(pagetable, 0, TRAPFRAME/PGSIZE, 1);
   freewalk(pagetable);
 }
 
@@ -309,34 +479,60 @@ uvmfree(pagetable_t pagetable, uint64 sz)
 // its memory into a child's page table.
 // Copies both the page table and the
 // physical memory.
+// Pages the parent has swapped out are read back from their slots
+// into the child. Each parent page is pinned while kalloc() runs, so
+// that the eviction it may trigger picks another page.
 // returns 0 on success, -1 on failure.
 // frees any allocated pages on failure.
 int
 uvmcopy(pagetable_t old, pagetable_t new, uint64 sz)
 {
+  struct proc *p = vmowner(old);
+  struct pgwalk w;
   pte_t *pte;
-  uint64 pa, i;
+  uint64 pa, i, pin_lo = 0, pin_hi = 0;
   uint flags;
   char *mem;
 
-  for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walk(old, i, 0)) == 0)
-      continue;   // page table entry hasn't been allocated
-    if((*pte & PTE_V) == 0)
+  if(p){
+    pin_lo = p->pin_lo;
+    pin_hi = p->pin_hi;
+  }
+  pgwalk_init(&w, old, 0, sz);
+  while((pte = pgwalk_next(&w, &i)) != 0){
+    if((*pte & (PTE_V | PTE_S)) == 0)
       continue;   // physical page hasn't been allocated
-    pa = PTE2PA(*pte);
-    flags = PTE_FLAGS(*pte);
+    if(p){
+      p->pin_lo = i;
+      p->pin_hi = i + PGSIZE;
+    }
     if((mem = kalloc()) == 0)
       goto err;
-    memmove(mem, (char*)pa, PGSIZE);
+    // the child has no swap-cache entry
+    flags = (PTE_FLAGS(*pte) & ~(PTE_SC | PTE_S)) | PTE_V;
+    if(*pte & PTE_V){
+      pa = PTE2PA(*pte);
+      memmove(mem, (char*)pa, PGSIZE);
+    } else if(p == 0 || swap_read_page(p, PTE_SLOT(*pte), (uint64)mem) < 0){
+      kfree(mem);
+      goto err;
+    }
     if(mappages(new, i, PGSIZE, (uint64)mem, flags) != 0){
       kfree(mem);
       goto err;
     }
   }
+  if(p){
+    p->pin_lo = pin_lo;
+    p->pin_hi = pin_hi;
+  }
   return 0;
 
  err:
+  if(p){
+    p->pin_lo = pin_lo;
+    p->pin_hi = pin_hi;
+  }
   uvmunmap(new, 0, i / PGSIZE, 1);
   return -1;
 }
@@ -352,72 +548,135 @@ uvmclear(pagetable_t pagetable, uint64 va)
   if(pte == 0)
     panic("uvmclear");
   *pte &= ~PTE_U;
+  tlb_flush_page(vmowner(pagetable), va);
 }
 
-// Copy from kernel to user.
-// Copy len bytes from src to virtual address dstva in a given page table.
-// Return 0 on success, -1 on error.
-int
-copyout(pagetable_t pagetable, uint64 dstva, char *src, uint64 len)
+// Directions for ucopy().
+#define UCOPY_IN  0   // user to kernel
+#define UCOPY_OUT 1   // kernel to user
+#define UCOPY_STR 2   // user to kernel, up to and including a '\0'
+
+// The user-copy engine behind copyin(), copyout() and copyinstr().
+// Works through [uva, uva+len) a batch of up to UCOPY_BATCH pages at a
+// time: when pagetable is the current process's, every missing page of
+// the batch (lazy, swapped out or executable) is faulted in first and
+// the batch is pinned against eviction while its later pages are
+// faulted and while it is copied. The copy itself walks the page table
+// once per leaf table rather than once per page.
+// Strings go one page at a time, so that nothing past the '\0' is
+// faulted in. Returns 0 on success, -1 on error.
+static int
+ucopy(pagetable_t pagetable, uint64 uva, char *kbuf, uint64 len, int dir)
 {
-  uint64 n, va0, pa0;
-  pte_t *pte;
+  struct proc *p = myproc();
+  int own = (p != 0 && pagetable == p->pagetable);
+  int err = 0, got_null = 0;
+  pte_t *l0, *pte;
+  uint64 l0va, va, va0, end, n, pa;
+  uint64 pin_lo = 0, pin_hi = 0;
+
+  // Nest inside a caller's upin(): put its range back when done.
+  if(own){
+    pin_lo = p->pin_lo;
+    pin_hi = p->pin_hi;
+  }
 
-  while(len > 0){
-    va0 = PGROUNDDOWN(dstva);
+  while(len > 0 && !err && !got_null){
+    va0 = PGROUNDDOWN(uva);
     if(va0 >= MAXVA)
       return -1;
-  
-    pa0 = walkaddr(pagetable, va0);
-    if(pa0 == 0) {
-      if((pa0 = vmfault(pagetable, va0, 0)) == 0) {
-        return -1;
+    end = PGROUNDUP(uva + len);
+    if(dir == UCOPY_STR || end < va0 || end - va0 > UCOPY_BATCH*PGSIZE)
+      end = va0 + (dir == UCOPY_STR ? 1 : UCOPY_BATCH) * PGSIZE;
+    if(end > MAXVA)
+      end = MAXVA;
+
+    // Fault the batch in and pin it. A process swapped out while
+    // its system call slept gets its mappings back here, before
+    // they are needed; usertrap() restores all others.
+    if(own){
+      if(p->swapped_out)
+        swapin_proc(p);
+      p->vmbusy++;
+      p->pin_lo = va0;
+      p->pin_hi = end;
+      for(va = va0; va < end && !err; va += PGSIZE)
+        if(!ismapped(pagetable, va) && vmfault(pagetable, va, dir != UCOPY_OUT) == 0)
+          err = 1;
+    }
+
+    // Copy it, one leaf page-table page at a time.
+    l0 = 0;
+    l0va = 0;
+    for(va = va0; va < end && len > 0 && !err && !got_null; va += PGSIZE){
+      if(l0 == 0 || (va >> PXSHIFT(1)) != l0va){
+        if((pte = walk(pagetable, va, 0)) == 0){
+          err = 1;
+          break;
+        }
+        l0 = pte - PX(0, va);
+        l0va = va >> PXSHIFT(1);
+      }
+      pte = &l0[PX(0, va)];
+      if((*pte & (PTE_V | PTE_U)) != (PTE_V | PTE_U) ||
+         (dir == UCOPY_OUT && (*pte & PTE_W) == 0)){
+        // not mapped, or copyout over read-only user text pages.
+        err = 1;
+        break;
+      }
+      pa = PTE2PA(*pte) + (uva - va);
+      n = PGSIZE - (uva - va);
+      if(n > len)
+        n = len;
+      if(dir == UCOPY_OUT){
+        // Written behind the MMU's back: mark it dirty by hand, or a
+        // swap-cache page would be dropped for its stale slot.
+        *pte |= PTE_D;
+        memmove((void *)pa, kbuf, n);
+      } else if(dir == UCOPY_IN){
+        memmove(kbuf, (void *)pa, n);
+      } else {
+        char *s = (char *)pa;
+        uint64 i;
+        for(i = 0; i < n && s[i] != '\0'; i++)
+          kbuf[i] = s[i];
+        if(i < n){
+          kbuf[i] = '\0';
+          got_null = 1;
+        }
       }
+      len -= n;
+      kbuf += n;
+      uva = va + PGSIZE;
     }
 
-    pte = walk(pagetable, va0, 0);
-    // forbid copyout over read-only user text pages.
-    if((*pte & PTE_W) == 0)
-      return -1;
-      
-    n = PGSIZE - (dstva - va0);
-    if(n > len)
-      n = len;
-    memmove((void *)(pa0 + (dstva - va0)), src, n);
-
-    len -= n;
-    src += n;
-    dstva = va0 + PGSIZE;
+    if(own){
+      p->pin_lo = pin_lo;
+      p->pin_hi = pin_hi;
+      p->vmbusy--;
+    }
   }
+  if(err || (dir == UCOPY_STR && !got_null))
+    return -1;
   return 0;
 }
 
+// Copy from kernel to user.
+// Copy len bytes from src to virtual address dstva in a given page table.
+// Return 0 on success, -1 on error.
+int
+copyout(pagetable_t pagetable, uint64 dstva, char *src, uint64 len)
+{
+  return ucopy(pagetable, dstva, src, len, UCOPY_OUT);
+}
+
 // Copy from user to kernel.
 // Copy len bytes to dst from virtual address srcva in a given page table.
 // Return 0 on success, -1 on error.
 int
 copyin(pagetable_t pagetable, char *dst, uint64 srcva, uint64 len)
 {
-  uint64 n, va0, pa0;
-
-  while(len > 0){
-    va0 = PGROUNDDOWN(srcva);
-    pa0 = walkaddr(pagetable, va0);
-    if(pa0 == 0) {
-      if((pa0 = vmfault(pagetable, va0, 0)) == 0) {
-        return -1;
-      }
-    }
-    n = PGSIZE - (srcva - va0);
-    if(n > len)
-      n = len;
-    memmove(dst, (void *)(pa0 + (srcva - va0)), n);
-
-    len -= n;
-    dst += n;
-    srcva = va0 + PGSIZE;
-  }
-  return 0;
+  return ucopy(pagetable, srcva, dst, len, UCOPY_IN);
 }
 
 // Copy a null-terminated string from user to kernel.
@@ -427,40 +686,7 @@ copyin(pagetable_t pagetable, char *dst, uint64 srcva, uint64 len)
 int
 copyinstr(pagetable_t pagetable, char *dst, uint64 srcva, uint64 max)
 {
-  uint64 n, va0, pa0;
-  int got_null = 0;
-
-  while(got_null == 0 && max > 0){
-    va0 = PGROUNDDOWN(srcva);
-    pa0 = walkaddr(pagetable, va0);
-    if(pa0 == 0)
-      return -1;
-    n = PGSIZE - (srcva - va0);
-    if(n > max)
-      n = max;
-
-    char *p = (char *) (pa0 + (srcva - va0));
-    while(n > 0){
-      if(*p == '\0'){
-        *dst = '\0';
-        got_null = 1;
-        break;
-      } else {
-        *dst = *p;
-      }
-      --n;
-      --max;
-      p++;
-      dst++;
-    }
-
-    srcva = va0 + PGSIZE;
-  }
-  if(got_null){
-    return 0;
-  } else {
-    return -1;
-  }
+  return ucopy(pagetable, srcva, dst, max, UCOPY_STR);
 }
 
 // allocate and map user memory if process is referencing a page
@@ -481,6 +707,11 @@ vmfault(pagetable_t pagetable, uint64 va, int read)
     return 0;
   }
 
+  // Page is on swap: read it back rather than handing out a zero page
+  pte_t *spte = walk(pagetable, va, 0);
+  if(spte && (*spte & PTE_S) != 0)
+    return swapin_page(p, va);
+
   // Allocate a physical page
   mem = (uint64) kalloc();
   if(mem == 0)
@@ -501,7 +732,7 @@ vmfault(pagetable_t pagetable, uint64 va, int read)
       }
       // Add to resident set and log
       uint64 page_va = PGROUNDDOWN(va);
-      add_to_resident_set(p, page_va, p->fifo_seq_num);
+      add_to_resident_set(p, page_va, p->fifo_seq_num, -1);
       printf("[pid %d] ALLOC va=0x%lx\n", p->pid, page_va);
       printf("[pid %d] RESIDENT va=0x%lx seq=%d\n", p->pid, page_va, p->fifo_seq_num);
       p->fifo_seq_num++;
@@ -520,7 +751,7 @@ vmfault(pagetable_t pagetable, uint64 va, int read)
     }
     // Add to resident set and log
     uint64 page_va = PGROUNDDOWN(va);
-    add_to_resident_set(p, page_va, p->fifo_seq_num);
+    add_to_resident_set(p, page_va, p->fifo_seq_num, -1);
     printf("[pid %d] ALLOC va=0x%lx\n", p->pid, page_va);
     printf("[pid %d] RESIDENT va=0x%lx seq=%d\n", p->pid, page_va, p->fifo_seq_num);
     p->fifo_seq_num++;
@@ -581,6 +812,7 @@ vmfault(pagetable_t pagetable, uint64 va, int read)
             kfree(mem_ptr);
             return 0;
           }
+          p->exec_bytes += filesz;
         }
 
         // Determine page permissions based on ELF flags
@@ -598,7 +830,7 @@ vmfault(pagetable_t pagetable, uint64 va, int read)
 
         found_seg = 1;
         // Add to resident set and log
-        add_to_resident_set(p, page_addr, p->fifo_seq_num);
+        add_to_resident_set(p, page_addr, p->fifo_seq_num, -1);
         printf("[pid %d] LOADEXEC va=0x%lx\n", p->pid, page_addr);
         printf("[pid %d] RESIDENT va=0x%lx seq=%d\n", p->pid, page_addr, p->fifo_seq_num);
         p->fifo_seq_num++;
@@ -617,6 +849,41 @@ vmfault(pagetable_t pagetable, uint64 va, int read)
   }
 }
 
+// Fault in [va, va+len) of the current process's memory and pin it
+// against eviction, for a caller about to copy to or from it while
+// holding bufs that a page fault could need: readi() holding a run
+// of disk blocks. At most UCOPY_BATCH pages. Returns 0, or -1 with
+// nothing pinned if a page cannot be faulted in. Undone by uunpin().
+int
+upin(uint64 va, uint64 len, int write)
+{
+  struct proc *p = myproc();
+  uint64 a, va0 = PGROUNDDOWN(va), end = PGROUNDUP(va + len);
+
+  if(end < va0 || end > MAXVA || end - va0 > UCOPY_BATCH*PGSIZE)
+    return -1;
+  if(p->swapped_out)
+    swapin_proc(p);
+  p->vmbusy++;
+  p->pin_lo = va0;
+  p->pin_hi = end;
+  for(a = va0; a < end; a += PGSIZE)
+    if(!ismapped(p->pagetable, a) && vmfault(p->pagetable, a, !write) == 0){
+      uunpin();
+      return -1;
+    }
+  return 0;
+}
+
+void
+uunpin(void)
+{
+  struct proc *p = myproc();
+
+  p->pin_lo = p->pin_hi = 0;
+  p->vmbusy--;
+}
+
 int
 ismapped(pagetable_t pagetable, uint64 va)
 {
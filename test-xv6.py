@@ -7,22 +7,29 @@
 # ./test-xv6.py -q usertests (runs the quick tests of usertests)
 # ./test-xv6.py crash  (runs the crash tests)
 # ./test-xv6.py log (runs the log crash test)
+# ./test-xv6.py perf (runs the benchmarks and compares them to perf-baseline.json)
+# ./test-xv6.py perf --cpus 1 --mem 32 --update (records a new baseline)
 
-import argparse, os, inspect, re, signal, subprocess, sys, time, fcntl
+import argparse, os, inspect, json, re, signal, subprocess, sys, time, fcntl
 from subprocess import run
 
 parser = argparse.ArgumentParser()
 parser.add_argument('testrex', help="test name or regular expression")
 parser.add_argument("-q", action='store_true', help="usertests quick")
+parser.add_argument("--cpus", type=int, default=3, help="perf: CPUs to run with")
+parser.add_argument("--mem", type=int, default=32, help="perf: RAM in MiB to run with")
+parser.add_argument("--baseline", default="perf-baseline.json", help="perf: baseline file")
+parser.add_argument("--update", action='store_true', help="perf: record results as the baseline")
 args = parser.parse_args()
 
 class QEMU(object):
 
-    def __init__(self, reset=False):
+    def __init__(self, reset=False, make_vars=()):
+        self.make_vars = list(make_vars)
         if reset:
             self.build_xv6()
             self.reset_fs()
-        q = ["make", "qemu"]
+        q = ["make", "qemu"] + self.make_vars
         self.proc = subprocess.Popen(q, stdin=subprocess.PIPE,
                                       stdout=subprocess.PIPE,
                                       stderr=subprocess.STDOUT)
@@ -38,13 +45,13 @@ class QEMU(object):
     def reset_fs(self):
         try:
             run(["rm", "fs.img"], check=True)
-            run(["make", "fs.img"], check=True)
+            run(["make", "fs.img"] + self.make_vars, check=True)
         except subprocess.CalledProcessError as e:
             print(f"Command failed with exit code {e.returncode}")
 
     def build_xv6(self):
         try:
-            run(["make", "kernel/kernel"], check=True)
+            run(["make", "kernel/kernel"] + self.make_vars, check=True)
         except subprocess.CalledProcessError as e:
             print(f"Command failed with exit code {e.returncode}")
 
@@ -211,6 +218,100 @@ def test_usertests(test=""):
     q.monitor('^ALL TESTS PASSED', progress='.*test', timeout=timeout)
     q.stop()
 
+# The benchmark set run by perf mode. Each command prints
+# "PAGEBENCH ..." or "PERFBENCH ..." lines of key=value fields.
+PERF_CMDS = [
+    "pagebench -p seq -w 50",
+    "pagebench -p rand -w 50",
+    "pagebench -p zipf -w 50",
+    "pagebench -p stride -w 50",
+    "pagebench -p loop -w 110",
+    "perfbench forkexec 100",
+    "perfbench fs 200",
+    "perfbench pipe 1024",
+]
+
+# Allowed growth over the baseline before a metric counts as a
+# regression: value <= base * (1 + rel) + abs. Every metric is
+# lower-is-better. Ticks are 100ms and noisy, hence the wide margin.
+PERF_TOLERANCE = {
+    "ticks": {"rel": 0.50, "abs": 2},
+    "default": {"rel": 0.25, "abs": 8},
+}
+
+def perf_parse(output):
+    """Turn benchmark output lines into {metric name: value}."""
+    metrics = {}
+    for line in output.splitlines():
+        m = re.search(r'(PAGEBENCH|PERFBENCH) (.*)', line)
+        if not m:
+            continue
+        fields = dict(re.findall(r'(\w+)=(\S+)', m.group(2)))
+        if m.group(1) == "PAGEBENCH":
+            prefix, keys = "pagebench." + fields.get("pattern", "?"), \
+                ["faults", "swapins", "swapouts", "evictions", "ticks"]
+        else:
+            prefix, keys = "perf." + fields.get("test", "?"), ["ticks"]
+        for k in keys:
+            if k in fields and fields[k].isdigit():
+                metrics[prefix + "." + k] = int(fields[k])
+    return metrics
+
+def perf_compare(metrics, base, tolerance):
+    """Return a list of regression descriptions (empty if none)."""
+    bad = []
+    for name, old in sorted(base.items()):
+        if name not in metrics:
+            bad.append("%s: missing (baseline %d)" % (name, old))
+            continue
+        kind = name.rsplit(".", 1)[1]
+        tol = tolerance.get(kind, tolerance["default"])
+        limit = old * (1 + tol["rel"]) + tol["abs"]
+        new = metrics[name]
+        status = "ok"
+        if new > limit:
+            status = "REGRESSION"
+            bad.append("%s: %d > %d (baseline %d)" % (name, new, limit, old))
+        print("%-32s %8d %8d  %s" % (name, old, new, status))
+    return bad
+
+def test_perf():
+    config = "cpus=%d mem=%d" % (args.cpus, args.mem)
+    print("Performance run,", config)
+    # MEM is compiled into the kernel, so start from a clean build.
+    run(["make", "clean"], check=True)
+    q = QEMU(True, ["CPUS=%d" % args.cpus, "MEM=%d" % args.mem])
+    time.sleep(3)
+    q.cmd(" ; ".join(PERF_CMDS) + " ; echo PERFDONE\n")
+    q.monitor('^PERFDONE', progress=r'(?!)', timeout=1200)
+    q.stop()
+    q.save_output()
+    metrics = perf_parse(q.output)
+
+    baselines = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baselines = json.load(f)
+    entry = baselines.get(config)
+    if args.update or entry is None:
+        baselines[config] = {"tolerance": PERF_TOLERANCE, "metrics": metrics}
+        with open(args.baseline, "w") as f:
+            json.dump(baselines, f, indent=2, sort_keys=True)
+            f.write("\n")
+        for name in sorted(metrics):
+            print("%-32s %8d" % (name, metrics[name]))
+        print("Baseline for %s written to %s" % (config, args.baseline))
+        return
+
+    print("%-32s %8s %8s" % ("metric", "baseline", "now"))
+    bad = perf_compare(metrics, entry["metrics"], entry.get("tolerance", PERF_TOLERANCE))
+    if bad:
+        print("FAIL: %d regression(s)" % len(bad))
+        for b in bad:
+            print("  " + b)
+        sys.exit(1)
+    print("OK")
+
 def main():
     print(args)
     rex = r'%s' % args.testrex
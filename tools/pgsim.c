@@ -0,0 +1,463 @@
+//############## LLM Generated Code Begins ##############
+
+// pgsim: replay page-reference traces captured by xv6's pgtrace
+// under several replacement policies, on the host.
+//
+//   pgsim [-m frames,frames,...] [trace]
+//
+// Reads "PGTRACE <tick> <pid> <vpn> <abits> <dbits>" lines (other
+// lines, e.g. the rest of the console log, are ignored) from trace or
+// standard input. Each set bit of abits is one reference; within a
+// sampling interval the order of references is unknown, so they are
+// taken in address order. Prints the fault rate of FIFO, Clock, LRU,
+// ARC and OPT for each memory size in frames (by default powers of
+// two up to the number of distinct pages), and the histogram of
+// reuse distances (LRU stack distances).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+static int *refs;          // the reference string, as dense page ids
+static int nrefs, caprefs;
+static int nwrites;        // references to pages that were dirty
+static int nsamples;
+
+static uint64_t *pages;    // dense id -> vpn (hash table below)
+static int npages;
+
+// --- vpn -> dense id, open addressing ---
+
+static uint64_t *htkey;
+static int *htval;
+static int htcap;
+
+static int
+page_id(uint64_t vpn)
+{
+  if(2 * (npages + 1) > htcap){
+    uint64_t *ok = htkey;
+    int *ov = htval, oc = htcap;
+    htcap = htcap ? 2 * htcap : 1024;
+    htkey = calloc(htcap, sizeof(*htkey));
+    htval = malloc(htcap * sizeof(*htval));
+    memset(htval, -1, htcap * sizeof(*htval));
+    for(int i = 0; i < oc; i++)
+      if(ov[i] >= 0){
+        uint64_t h = ok[i] * 0x9e3779b97f4a7c15ULL % htcap;
+        while(htval[h] >= 0)
+          h = (h + 1) % htcap;
+        htkey[h] = ok[i];
+        htval[h] = ov[i];
+      }
+    free(ok);
+    free(ov);
+    pages = realloc(pages, htcap * sizeof(*pages));
+  }
+  uint64_t h = vpn * 0x9e3779b97f4a7c15ULL % htcap;
+  while(htval[h] >= 0){
+    if(htkey[h] == vpn)
+      return htval[h];
+    h = (h + 1) % htcap;
+  }
+  htkey[h] = vpn;
+  htval[h] = npages;
+  pages[npages] = vpn;
+  return npages++;
+}
+
+static void
+addref(int id)
+{
+  if(nrefs == caprefs){
+    caprefs = caprefs ? 2 * caprefs : 4096;
+    refs = realloc(refs, caprefs * sizeof(*refs));
+  }
+  refs[nrefs++] = id;
+}
+
+static void
+readtrace(FILE *f)
+{
+  char buf[512];
+
+  while(fgets(buf, sizeof(buf), f)){
+    char *s = strstr(buf, "PGTRACE ");
+    unsigned long long vpn, a, d;
+    unsigned tick;
+    int pid;
+    if(s == 0 || sscanf(s, "PGTRACE %u %d %llx %llx %llx", &tick, &pid, &vpn, &a, &d) != 5)
+      continue;
+    nsamples++;
+    for(int i = 0; i < 64; i++)
+      if(a & (1ULL << i)){
+        addref(page_id(vpn + i));
+        if(d & (1ULL << i))
+          nwrites++;
+      }
+  }
+}
+
+// --- doubly-linked lists over page ids, for LRU and ARC ---
+
+struct list {
+  int head, tail, n;       // head is the most recently inserted
+};
+
+static int *lprev, *lnext, *lwhich;   // per page; lwhich = list number or -1
+
+static void
+list_init(struct list *l)
+{
+  l->head = l->tail = -1;
+  l->n = 0;
+}
+
+static void
+list_remove(struct list *l, int id)
+{
+  if(lprev[id] >= 0) lnext[lprev[id]] = lnext[id]; else l->head = lnext[id];
+  if(lnext[id] >= 0) lprev[lnext[id]] = lprev[id]; else l->tail = lprev[id];
+  l->n--;
+  lwhich[id] = -1;
+}
+
+static void
+list_push(struct list *l, int id, int which)
+{
+  lprev[id] = -1;
+  lnext[id] = l->head;
+  if(l->head >= 0) lprev[l->head] = id; else l->tail = id;
+  l->head = id;
+  l->n++;
+  lwhich[id] = which;
+}
+
+static int
+list_pop_tail(struct list *l)
+{
+  int id = l->tail;
+  list_remove(l, id);
+  return id;
+}
+
+// --- policies: each returns the number of faults with m frames ---
+
+static long
+sim_fifo(int m)
+{
+  int *q = malloc(m * sizeof(int)), head = 0, n = 0;
+  char *in = calloc(npages, 1);
+  long faults = 0;
+
+  for(int t = 0; t < nrefs; t++){
+    int id = refs[t];
+    if(in[id])
+      continue;
+    faults++;
+    if(n == m){
+      in[q[head]] = 0;
+      q[head] = id;
+      head = (head + 1) % m;
+    } else {
+      q[(head + n++) % m] = id;
+    }
+    in[id] = 1;
+  }
+  free(q);
+  free(in);
+  return faults;
+}
+
+static long
+sim_clock(int m)
+{
+  int *frame = malloc(m * sizeof(int)), hand = 0, n = 0;
+  int *where = malloc(npages * sizeof(int));
+  char *refbit = calloc(m, 1);
+  long faults = 0;
+
+  for(int i = 0; i < npages; i++)
+    where[i] = -1;
+  for(int t = 0; t < nrefs; t++){
+    int id = refs[t];
+    if(where[id] >= 0){
+      refbit[where[id]] = 1;
+      continue;
+    }
+    faults++;
+    if(n < m){
+      frame[n] = id;
+      refbit[n] = 1;
+      where[id] = n++;
+      continue;
+    }
+    while(refbit[hand]){
+      refbit[hand] = 0;
+      hand = (hand + 1) % m;
+    }
+    where[frame[hand]] = -1;
+    frame[hand] = id;
+    refbit[hand] = 1;
+    where[id] = hand;
+    hand = (hand + 1) % m;
+  }
+  free(frame);
+  free(where);
+  free(refbit);
+  return faults;
+}
+
+static long
+sim_lru(int m)
+{
+  struct list l;
+  long faults = 0;
+
+  list_init(&l);
+  for(int i = 0; i < npages; i++)
+    lwhich[i] = -1;
+  for(int t = 0; t < nrefs; t++){
+    int id = refs[t];
+    if(lwhich[id] >= 0){
+      list_remove(&l, id);
+    } else {
+      faults++;
+      if(l.n == m)
+        list_pop_tail(&l);
+    }
+    list_push(&l, id, 0);
+  }
+  return faults;
+}
+
+// ARC (Megiddo and Modha): T1/T2 hold resident pages seen once and
+// more than once, B1/B2 remember recently evicted ones, and p is
+// the adaptive target size of T1.
+static long
+sim_arc(int c)
+{
+  struct list T1, T2, B1, B2;
+  enum { t1, t2, b1, b2 };
+  long faults = 0;
+  int p = 0;
+
+  list_init(&T1); list_init(&T2); list_init(&B1); list_init(&B2);
+  for(int i = 0; i < npages; i++)
+    lwhich[i] = -1;
+
+  for(int t = 0; t < nrefs; t++){
+    int x = refs[t];
+    int w = lwhich[x];
+
+    if(w == t1 || w == t2){
+      list_remove(w == t1 ? &T1 : &T2, x);
+      list_push(&T2, x, t2);
+      continue;
+    }
+    faults++;
+
+    // replace(): make room in T1 + T2, moving the victim to B1/B2
+    #define REPLACE(inb2) do { \
+        if(T1.n > 0 && (T1.n > p || ((inb2) && T1.n == p))) \
+          list_push(&B1, list_pop_tail(&T1), b1); \
+        else if(T2.n > 0) \
+          list_push(&B2, list_pop_tail(&T2), b2); \
+      } while(0)
+
+    if(w == b1){
+      int d = B1.n >= B2.n ? 1 : B2.n / B1.n;
+      p = p + d < c ? p + d : c;
+      REPLACE(0);
+      list_remove(&B1, x);
+      list_push(&T2, x, t2);
+    } else if(w == b2){
+      int d = B2.n >= B1.n ? 1 : B1.n / B2.n;
+      p = p - d > 0 ? p - d : 0;
+      REPLACE(1);
+      list_remove(&B2, x);
+      list_push(&T2, x, t2);
+    } else {
+      if(T1.n + B1.n == c){
+        if(T1.n < c){
+          list_pop_tail(&B1);
+          REPLACE(0);
+        } else {
+          list_pop_tail(&T1);
+        }
+      } else if(T1.n + T2.n + B1.n + B2.n >= c){
+        if(T1.n + T2.n + B1.n + B2.n == 2 * c)
+          list_pop_tail(&B2);
+        REPLACE(0);
+      }
+      list_push(&T1, x, t1);
+    }
+    #undef REPLACE
+  }
+  return faults;
+}
+
+// Belady's OPT: evict the page whose next use is furthest away.
+// Resident pages sit in a max-heap keyed by next use; entries made
+// stale by a later reference are skipped when popped.
+static long
+sim_opt(int m)
+{
+  int *next = malloc(nrefs * sizeof(int));
+  int *last = malloc(npages * sizeof(int));
+  int *cur = malloc(npages * sizeof(int));    // current next use, or -1 if not resident
+  struct ent { int when, id; } *heap = malloc((nrefs + 1) * sizeof(*heap));
+  int nheap = 0, n = 0;
+  long faults = 0;
+
+  for(int i = 0; i < npages; i++){
+    last[i] = nrefs;       // "never again"
+    cur[i] = -1;
+  }
+  for(int t = nrefs - 1; t >= 0; t--){
+    next[t] = last[refs[t]];
+    last[refs[t]] = t;
+  }
+
+  for(int t = 0; t < nrefs; t++){
+    int id = refs[t];
+    if(cur[id] < 0){
+      faults++;
+      if(n == m){
+        for(;;){
+          struct ent top = heap[0];
+          heap[0] = heap[--nheap];
+          for(int i = 0;;){
+            int l = 2*i + 1, r = l + 1, big = i;
+            if(l < nheap && heap[l].when > heap[big].when) big = l;
+            if(r < nheap && heap[r].when > heap[big].when) big = r;
+            if(big == i) break;
+            struct ent tmp = heap[i]; heap[i] = heap[big]; heap[big] = tmp;
+            i = big;
+          }
+          if(cur[top.id] == top.when){
+            cur[top.id] = -1;
+            break;
+          }
+        }
+      } else {
+        n++;
+      }
+    }
+    cur[id] = next[t];
+    int i = nheap++;
+    heap[i].when = next[t];
+    heap[i].id = id;
+    while(i > 0 && heap[(i-1)/2].when < heap[i].when){
+      struct ent tmp = heap[i]; heap[i] = heap[(i-1)/2]; heap[(i-1)/2] = tmp;
+      i = (i-1)/2;
+    }
+  }
+  free(next);
+  free(last);
+  free(cur);
+  free(heap);
+  return faults;
+}
+
+// --- reuse distance: distinct pages since the previous reference ---
+
+static void
+reuse_histogram(void)
+{
+  // Fenwick tree over time: a 1 at the latest reference of each page.
+  int *bit = calloc(nrefs + 1, sizeof(int));
+  int *last = malloc(npages * sizeof(int));
+  long hist[40] = {0}, cold = 0;
+
+  for(int i = 0; i < npages; i++)
+    last[i] = -1;
+  for(int t = 0; t < nrefs; t++){
+    int id = refs[t];
+    if(last[id] < 0){
+      cold++;
+    } else {
+      // marks in (last, t) = prefix(t) - prefix(last+1)
+      int d = 0;
+      for(int i = t; i > 0; i -= i & -i) d += bit[i];
+      for(int i = last[id] + 1; i > 0; i -= i & -i) d -= bit[i];
+      int b = 0;
+      while((1 << b) <= d) b++;
+      hist[b]++;
+      for(int i = last[id] + 1; i <= nrefs; i += i & -i) bit[i]--;
+    }
+    for(int i = t + 1; i <= nrefs; i += i & -i) bit[i]++;
+    last[id] = t;
+  }
+
+  printf("\nreuse distance   references\n");
+  printf("%-16s %ld\n", "cold", cold);
+  for(int b = 0; b < 40; b++){
+    char range[32];
+    if(hist[b] == 0)
+      continue;
+    if(b == 0)
+      snprintf(range, sizeof(range), "0");
+    else if(b == 1)
+      snprintf(range, sizeof(range), "1");
+    else
+      snprintf(range, sizeof(range), "%d-%d", 1 << (b-1), (1 << b) - 1);
+    printf("%-16s %ld\n", range, hist[b]);
+  }
+  free(bit);
+  free(last);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int sizes[64], nsizes = 0;
+  FILE *f = stdin;
+
+  for(int i = 1; i < argc; i++){
+    if(strcmp(argv[i], "-m") == 0 && i + 1 < argc){
+      for(char *s = strtok(argv[++i], ","); s && nsizes < 64; s = strtok(0, ","))
+        if(atoi(s) > 0)
+          sizes[nsizes++] = atoi(s);
+    } else if(argv[i][0] == '-'){
+      fprintf(stderr, "usage: pgsim [-m frames,frames,...] [trace]\n");
+      exit(1);
+    } else if((f = fopen(argv[i], "r")) == 0){
+      perror(argv[i]);
+      exit(1);
+    }
+  }
+
+  readtrace(f);
+  if(nrefs == 0){
+    fprintf(stderr, "pgsim: no PGTRACE records\n");
+    exit(1);
+  }
+  if(nsizes == 0){
+    for(int m = 4; m < npages && nsizes < 63; m *= 2)
+      sizes[nsizes++] = m;
+    sizes[nsizes++] = npages;
+  }
+  lprev = malloc(npages * sizeof(int));
+  lnext = malloc(npages * sizeof(int));
+  lwhich = malloc(npages * sizeof(int));
+
+  printf("%d references to %d pages in %d samples, %d%% to dirty pages\n",
+         nrefs, npages, nsamples, (int)(100LL * nwrites / nrefs));
+  printf("\nfault rate (%%)\n");
+  printf("%8s %8s %8s %8s %8s %8s\n", "frames", "FIFO", "Clock", "LRU", "ARC", "OPT");
+  for(int i = 0; i < nsizes; i++){
+    int m = sizes[i];
+    printf("%8d %8.2f %8.2f %8.2f %8.2f %8.2f\n", m,
+           100.0 * sim_fifo(m) / nrefs,
+           100.0 * sim_clock(m) / nrefs,
+           100.0 * sim_lru(m) / nrefs,
+           100.0 * sim_arc(m) / nrefs,
+           100.0 * sim_opt(m) / nrefs);
+  }
+  reuse_histogram();
+  return 0;
+}
+
+//############## LLM Generated Code Ends ################
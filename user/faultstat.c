@@ -0,0 +1,76 @@
+//############## LLM Generated Code Begins ##############
+
+// faultstat [pid]: page-fault latency percentiles of a process,
+// or of the whole system if no pid (or 0) is given.
+
+#include "kernel/types.h"
+#include "user/user.h"
+#include "kernel/memstat.h"
+
+// r_time() ticks per microsecond (QEMU's timebase is 10 MHz).
+#define TICKS_PER_US 10
+
+static char *names[NFLAT] = {
+  [FLAT_ALLOC]    "alloc",
+  [FLAT_LOADEXEC] "loadexec",
+  [FLAT_SWAPIN]   "swapin",
+  [FLAT_SWAPOUT]  "swapout",
+};
+
+// Upper bound, in ticks, of the latency below which pct percent
+// of the faults in h fall. Only bucket resolution is available.
+static uint64
+percentile(struct fault_hist *h, int pct)
+{
+  uint64 want = (h->count * pct + 99) / 100;
+  uint64 seen = 0;
+
+  for(int b = 0; b < FHIST_NBUCKET; b++){
+    seen += h->bucket[b];
+    if(seen >= want && seen > 0){
+      uint64 bound = 2UL << b;
+      return bound < h->max ? bound : h->max;
+    }
+  }
+  return h->max;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct fault_stat fs;
+  int pid = 0;
+
+  if(argc > 2){
+    fprintf(2, "usage: faultstat [pid]\n");
+    exit(1);
+  }
+  if(argc == 2)
+    pid = atoi(argv[1]);
+  if(faultstat(pid, &fs) < 0){
+    fprintf(2, "faultstat: no process %d\n", pid);
+    exit(1);
+  }
+
+  if(pid == 0)
+    printf("page-fault latency, all processes (us)\n");
+  else
+    printf("page-fault latency, pid %d (us)\n", pid);
+  printf("class    count\tmean\tp50\tp90\tp99\tmax\n");
+  for(int k = 0; k < NFLAT; k++){
+    struct fault_hist *h = &fs.hist[k];
+    uint64 mean = h->count ? h->total / h->count : 0;
+    printf("%s", names[k]);
+    for(int i = strlen(names[k]); i < 9; i++)
+      printf(" ");
+    printf("%ld\t%ld\t%ld\t%ld\t%ld\t%ld\n", h->count,
+           mean / TICKS_PER_US,
+           percentile(h, 50) / TICKS_PER_US,
+           percentile(h, 90) / TICKS_PER_US,
+           percentile(h, 99) / TICKS_PER_US,
+           h->max / TICKS_PER_US);
+  }
+  exit(0);
+}
+
+//############## LLM Generated Code Ends ################
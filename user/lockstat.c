@@ -0,0 +1,100 @@
+//############## LLM Generated Code Begins ##############
+
+// lockstat: spinlock contention statistics, by lock name.
+//
+//   lockstat [n]            print the n most contended locks (default 10)
+//   lockstat -r             reset the statistics
+//   lockstat cmd [arg ...]  reset, run cmd, then print
+//
+// Hold times are in microseconds (QEMU's timebase is 10 MHz).
+
+#include "kernel/types.h"
+#include "user/user.h"
+#include "kernel/memstat.h"
+
+#define MAXLOCKS     64
+#define TICKS_PER_US 10
+
+static struct lock_stat ls[MAXLOCKS];
+
+static int
+isnum(char *s)
+{
+  if(*s == 0)
+    return 0;
+  for(; *s; s++)
+    if(*s < '0' || *s > '9')
+      return 0;
+  return 1;
+}
+
+// Does a rank as more contended than b?
+static int
+worse(struct lock_stat *a, struct lock_stat *b)
+{
+  if(a->ncontended != b->ncontended)
+    return a->ncontended > b->ncontended;
+  return a->nspin > b->nspin;
+}
+
+static void
+dump(int ntop)
+{
+  int n;
+
+  if((n = lockstat(ls, MAXLOCKS)) < 0){
+    fprintf(2, "lockstat: kernel built without LOCKSTAT\n");
+    exit(1);
+  }
+  for(int i = 1; i < n; i++){
+    struct lock_stat t = ls[i];
+    int j = i;
+    for(; j > 0 && worse(&t, &ls[j-1]); j--)
+      ls[j] = ls[j-1];
+    ls[j] = t;
+  }
+
+  printf("name            acquire   contended  spins     hold-avg  hold-max\n");
+  for(int i = 0; i < n && i < ntop; i++){
+    struct lock_stat *l = &ls[i];
+    printf("%s", l->name);
+    for(int k = strlen(l->name); k < 16; k++)
+      printf(" ");
+    printf("%ld\t  %ld\t     %ld\t       %ld\t %ld\n",
+           l->nacquire, l->ncontended, l->nspin,
+           l->nacquire ? l->total_hold / l->nacquire / TICKS_PER_US : 0,
+           l->max_hold / TICKS_PER_US);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  if(argc == 1){
+    dump(10);
+  } else if(strcmp(argv[1], "-r") == 0){
+    if(lockstat(0, 0) < 0){
+      fprintf(2, "lockstat: kernel built without LOCKSTAT\n");
+      exit(1);
+    }
+  } else if(isnum(argv[1])){
+    dump(atoi(argv[1]));
+  } else {
+    lockstat(0, 0);
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "lockstat: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      fprintf(2, "lockstat: exec %s failed\n", argv[1]);
+      exit(1);
+    }
+    wait(0);
+    dump(10);
+  }
+  exit(0);
+}
+
+//############## LLM Generated Code Ends ################
@@ -0,0 +1,193 @@
+//############## LLM Generated Code Begins ##############
+
+// pagebench: paging benchmark with standard access patterns.
+//
+//   pagebench [-p pattern] [-w pct | -n pages] [-r refs] [-s stride]
+//             [-z seed] [-R]
+//
+// pattern is seq, rand, zipf, stride, loop or all (the default).
+// The working set is pct percent of the free frames (default 50;
+// 125 for loop, which must not fit in memory) or exactly pages
+// pages. Each pattern makes refs page references (default twice the
+// working set) in a child of its own, writing one byte per
+// reference unless -R is given, and prints one line:
+//
+//   PAGEBENCH pattern=.. pages=.. refs=.. faults=.. swapins=..
+//             swapouts=.. evictions=.. ticks=..
+
+#include "kernel/types.h"
+#include "user/user.h"
+#include "kernel/memstat.h"
+
+#define PGSIZE 4096
+
+static char *patterns[] = { "seq", "rand", "zipf", "stride", "loop" };
+#define NPATTERN (sizeof(patterns) / sizeof(patterns[0]))
+
+static int pct = -1, npages = -1, nrefs = -1, stride = 16, readonly;
+static uint seed = 1;
+
+static uint
+rnd(void)
+{
+  // xorshift32
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+// Integer log2, rounded down.
+static int
+ilog2(uint64 x)
+{
+  int l = 0;
+  while(x >>= 1)
+    l++;
+  return l;
+}
+
+// A rank in [0, n) drawn with probability roughly proportional to
+// 1/(rank+1), i.e. Zipf with s = 1. Uses k = n^u for uniform u,
+// whose density is proportional to 1/k, computed in 16.16 fixed
+// point with 2^f ~ 1 + f for the fractional part.
+// Draws above n are rejected.
+static int
+zipf(int n)
+{
+  uint64 k;
+
+  do {
+    uint64 u = rnd() & 0xffff;                     // [0, 1) in 16.16
+    uint64 e = u * (ilog2(n) + 1);                 // u * log2(2n), roughly
+    k = (((1UL << 16) + (e & 0xffff)) << (e >> 16)) >> 16;
+  } while(k > n);                                  // overshot: draw again
+  return k - 1;
+}
+
+// Page number of reference i of pattern pat over n pages.
+static int
+nextpage(char *pat, int i, int n)
+{
+  if(strcmp(pat, "seq") == 0 || strcmp(pat, "loop") == 0)
+    return i % n;
+  if(strcmp(pat, "rand") == 0)
+    return rnd() % n;
+  if(strcmp(pat, "zipf") == 0)
+    return zipf(n);
+  // stride: every stride-th page, then the same starting one later
+  int per = (n + stride - 1) / stride;       // pages per sweep
+  int sweep = (i / per) % stride;
+  int pg = sweep + (i % per) * stride;
+  return pg < n ? pg : (i % n);
+}
+
+static void
+run(char *pat)
+{
+  struct vm_stat vs;
+  struct proc_vm_stat before, after;
+  struct page_stat2 dummy;
+  int n = npages, refs = nrefs;
+  char *mem;
+
+  if(n < 0){
+    int p = pct;
+    if(p < 0)
+      p = strcmp(pat, "loop") == 0 ? 125 : 50;
+    if(vmstat(&vs) < 0){
+      fprintf(2, "pagebench: vmstat failed\n");
+      exit(1);
+    }
+    n = vs.free_frames * p / 100;
+  }
+  if(n < 1)
+    n = 1;
+  if(refs < 0)
+    refs = 2 * n;
+
+  if((mem = sbrk((uint64)n * PGSIZE)) == (char*)-1){
+    fprintf(2, "pagebench: sbrk(%d pages) failed\n", n);
+    exit(1);
+  }
+  memstat2(0, &dummy, 0, &before);
+  int t0 = uptime();
+  for(int i = 0; i < refs; i++){
+    char *a = mem + (uint64)nextpage(pat, i, n) * PGSIZE;
+    if(readonly)
+      *(volatile char *)a;
+    else
+      *a = i;
+  }
+  int t1 = uptime();
+  memstat2(0, &dummy, 0, &after);
+
+  uint64 faults = 0;
+  for(int k = 0; k < NFAULT; k++)
+    faults += after.faults[k] - before.faults[k];
+  printf("PAGEBENCH pattern=%s pages=%d refs=%d faults=%ld swapins=%ld swapouts=%ld evictions=%ld ticks=%d\n",
+         pat, n, refs, faults,
+         after.swapins - before.swapins,
+         after.swapouts - before.swapouts,
+         after.evictions - before.evictions,
+         t1 - t0);
+}
+
+static void
+usage(void)
+{
+  fprintf(2, "usage: pagebench [-p seq|rand|zipf|stride|loop|all] [-w pct | -n pages]\n"
+             "                 [-r refs] [-s stride] [-z seed] [-R]\n");
+  exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *pat = "all";
+
+  for(int i = 1; i < argc; i++){
+    if(strcmp(argv[i], "-R") == 0){
+      readonly = 1;
+      continue;
+    }
+    if(argv[i][0] != '-' || argv[i][2] != 0 || i + 1 >= argc)
+      usage();
+    char *v = argv[++i];
+    switch(argv[i-1][1]){
+    case 'p': pat = v; break;
+    case 'w': pct = atoi(v); break;
+    case 'n': npages = atoi(v); break;
+    case 'r': nrefs = atoi(v); break;
+    case 's': stride = atoi(v); break;
+    case 'z': seed = atoi(v); break;
+    default: usage();
+    }
+  }
+  if(stride < 1 || seed == 0)
+    usage();
+
+  for(int k = 0; k < NPATTERN; k++){
+    if(strcmp(pat, "all") != 0 && strcmp(pat, patterns[k]) != 0)
+      continue;
+    // A fresh process per pattern, so that one pattern's resident
+    // pages and swap slots don't skew the next.
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "pagebench: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      run(patterns[k]);
+      exit(0);
+    }
+    wait(0);
+    if(strcmp(pat, "all") != 0)
+      exit(0);
+  }
+  if(strcmp(pat, "all") != 0)
+    usage();
+  exit(0);
+}
+
+//############## LLM Generated Code Ends ################
@@ -0,0 +1,134 @@
+//############## LLM Generated Code Begins ##############
+
+// perfbench: micro-benchmarks for the perf mode of test-xv6.py.
+//
+//   perfbench forkexec n   fork and exec a no-op child n times
+//   perfbench fs kb        write then read back a kb KiB file
+//   perfbench pipe kb      push kb KiB through a pipe to a child
+//
+// Each test prints machine-parseable lines of the form
+//   PERFBENCH test=<name> <key>=<value> ... ticks=<ticks>
+
+#include "kernel/types.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+#define BUFSZ 1024
+
+static char buf[BUFSZ];
+
+static void
+forkexec(int n)
+{
+  char *argv[] = { "perfbench", "nop", 0 };
+  int t0 = uptime();
+
+  for(int i = 0; i < n; i++){
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "perfbench: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec("perfbench", argv);
+      fprintf(2, "perfbench: exec failed\n");
+      exit(1);
+    }
+    wait(0);
+  }
+  printf("PERFBENCH test=forkexec n=%d ticks=%d\n", n, uptime() - t0);
+}
+
+static void
+fs(int kb)
+{
+  char *name = "perfbench.tmp";
+  int fd, t0, t1;
+
+  for(int i = 0; i < BUFSZ; i++)
+    buf[i] = i;
+
+  t0 = uptime();
+  if((fd = open(name, O_CREATE | O_RDWR | O_TRUNC)) < 0){
+    fprintf(2, "perfbench: cannot create %s\n", name);
+    exit(1);
+  }
+  for(int i = 0; i < kb; i++){
+    if(write(fd, buf, BUFSZ) != BUFSZ){
+      fprintf(2, "perfbench: write failed\n");
+      exit(1);
+    }
+  }
+  close(fd);
+  t1 = uptime();
+  printf("PERFBENCH test=fswrite kb=%d ticks=%d\n", kb, t1 - t0);
+
+  if((fd = open(name, O_RDONLY)) < 0){
+    fprintf(2, "perfbench: cannot open %s\n", name);
+    exit(1);
+  }
+  int got = 0, n;
+  while((n = read(fd, buf, BUFSZ)) > 0)
+    got += n;
+  close(fd);
+  printf("PERFBENCH test=fsread kb=%d ticks=%d\n", got / 1024, uptime() - t1);
+  unlink(name);
+}
+
+static void
+pipetest(int kb)
+{
+  int fds[2], t0;
+
+  if(pipe(fds) < 0){
+    fprintf(2, "perfbench: pipe failed\n");
+    exit(1);
+  }
+  t0 = uptime();
+  int pid = fork();
+  if(pid < 0){
+    fprintf(2, "perfbench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(fds[1]);
+    while(read(fds[0], buf, BUFSZ) > 0)
+      ;
+    exit(0);
+  }
+  close(fds[0]);
+  for(int i = 0; i < kb; i++){
+    if(write(fds[1], buf, BUFSZ) != BUFSZ){
+      fprintf(2, "perfbench: pipe write failed\n");
+      exit(1);
+    }
+  }
+  close(fds[1]);
+  wait(0);
+  printf("PERFBENCH test=pipe kb=%d ticks=%d\n", kb, uptime() - t0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  if(argc == 2 && strcmp(argv[1], "nop") == 0)
+    exit(0);
+  if(argc != 3){
+    fprintf(2, "usage: perfbench forkexec n | fs kb | pipe kb\n");
+    exit(1);
+  }
+  int n = atoi(argv[2]);
+  if(strcmp(argv[1], "forkexec") == 0)
+    forkexec(n);
+  else if(strcmp(argv[1], "fs") == 0)
+    fs(n);
+  else if(strcmp(argv[1], "pipe") == 0)
+    pipetest(n);
+  else {
+    fprintf(2, "perfbench: unknown test %s\n", argv[1]);
+    exit(1);
+  }
+  exit(0);
+}
+
+//############## LLM Generated Code Ends ################
@@ -0,0 +1,114 @@
+//############## LLM Generated Code Begins ##############
+
+// pgtrace [-i ticks] cmd [arg ...]: run cmd with page-reference
+// tracing on and print the trace, one line per record:
+//
+//   PGTRACE <tick> <pid> <vpn> <abits> <dbits>
+//
+// with vpn and the bitmaps in hex. Capture the console output
+// (e.g. make qemu | tee log) and replay it on the host with
+// tools/pgsim.
+
+#include "kernel/types.h"
+#include "user/user.h"
+#include "kernel/memstat.h"
+
+#define NREC 64
+
+static struct pgtrace_rec rec[NREC];
+
+static char line[128];
+static int len;
+
+static void
+puts_(char *s)
+{
+  while(*s)
+    line[len++] = *s++;
+}
+
+static void
+putnum(uint64 x, int base)
+{
+  char tmp[20];
+  int i = 0;
+
+  do {
+    tmp[i++] = "0123456789abcdef"[x % base];
+    x /= base;
+  } while(x);
+  while(i > 0)
+    line[len++] = tmp[--i];
+}
+
+// Print one record with a single write, so that it is not
+// interleaved with other console output.
+static void
+emit(struct pgtrace_rec *r)
+{
+  len = 0;
+  puts_("PGTRACE ");
+  putnum(r->tick, 10);
+  puts_(" ");
+  putnum(r->pid, 10);
+  puts_(" ");
+  putnum(r->vpn, 16);
+  puts_(" ");
+  putnum(r->abits, 16);
+  puts_(" ");
+  putnum(r->dbits, 16);
+  puts_("\n");
+  write(1, line, len);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int interval = 1, first = 1, fds[2], n, total = 0;
+  char go = 0;
+
+  if(argc > 2 && strcmp(argv[1], "-i") == 0){
+    interval = atoi(argv[2]);
+    first = 3;
+  }
+  if(first >= argc || interval < 1){
+    fprintf(2, "usage: pgtrace [-i ticks] cmd [arg ...]\n");
+    exit(1);
+  }
+
+  // The child waits on the pipe until its trace has been set up.
+  if(pipe(fds) < 0){
+    fprintf(2, "pgtrace: pipe failed\n");
+    exit(1);
+  }
+  int pid = fork();
+  if(pid < 0){
+    fprintf(2, "pgtrace: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(fds[1]);
+    read(fds[0], &go, 1);
+    close(fds[0]);
+    exec(argv[first], argv + first);
+    fprintf(2, "pgtrace: exec %s failed\n", argv[first]);
+    exit(1);
+  }
+  close(fds[0]);
+  pgtrace(pid, interval);
+  write(fds[1], &go, 1);
+  close(fds[1]);
+
+  while((n = pgtraceread(rec, NREC)) >= 0){
+    for(int i = 0; i < n; i++)
+      emit(&rec[i]);
+    total += n;
+    if(n < NREC)
+      pause(interval);
+  }
+  wait(0);
+  printf("PGTRACE-END records=%d dropped=%d\n", total, pgtrace(0, 0));
+  exit(0);
+}
+
+//############## LLM Generated Code Ends ################
@@ -0,0 +1,264 @@
+//############## LLM Generated Code Begins ##############
+
+// prof: front end for the kernel's sampling profiler.
+//
+//   prof start            start sampling on all CPUs
+//   prof stop             stop sampling
+//   prof report [n]       print the n hottest functions (default 20)
+//   prof cmd [arg ...]    run cmd with sampling on, then report
+//
+// Kernel pcs are symbolized with /kernel.sym and user pcs with
+// /<process name>.sym, which the Makefile puts in fs.img.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+#include "kernel/memstat.h"
+
+#define MAXSAMPLES 8192
+#define NTAB       16     // symbol tables kept loaded: kernel + programs
+#define NTOP       20
+
+struct sym {
+  uint64 addr;
+  char *name;
+  int hits;
+};
+
+struct symtab {
+  char name[16];          // "kernel", or a process name
+  struct sym *syms;       // sorted by addr; 0 if not loadable
+  int n;
+  int unknown;            // samples no symbol covered
+};
+
+static struct symtab tabs[NTAB];
+static int ntabs;
+
+static uint64
+hex(char **sp)
+{
+  uint64 v = 0;
+  char *s = *sp;
+
+  for(;; s++){
+    if(*s >= '0' && *s <= '9')
+      v = v*16 + *s - '0';
+    else if(*s >= 'a' && *s <= 'f')
+      v = v*16 + *s - 'a' + 10;
+    else
+      break;
+  }
+  *sp = s;
+  return v;
+}
+
+// Labels that are not functions: sections, source files, locals.
+static int
+notfunc(char *name)
+{
+  int n = strlen(name);
+
+  if(name[0] == '.' || name[0] == '$' || n == 0)
+    return 1;
+  if(n > 2 && name[n-2] == '.' && (name[n-1] == 'c' || name[n-1] == 'S'))
+    return 1;
+  return 0;
+}
+
+// Read "<name>.sym", a list of "addr name" lines, into t.
+static void
+loadsyms(struct symtab *t, char *name)
+{
+  char path[32];
+  struct stat st;
+  char *buf, *s, *e;
+  int fd, n, cap;
+
+  strcpy(t->name, name);  // names are at most 15 characters
+  t->syms = 0;
+  t->n = 0;
+  strcpy(path, "/");
+  strcpy(path + 1, name);
+  strcpy(path + strlen(path), ".sym");
+  if((fd = open(path, O_RDONLY)) < 0)
+    return;
+  if(fstat(fd, &st) < 0 || (buf = malloc(st.size + 1)) == 0){
+    close(fd);
+    return;
+  }
+  for(n = 0; n < st.size; ){
+    int r = read(fd, buf + n, st.size - n);
+    if(r <= 0)
+      break;
+    n += r;
+  }
+  close(fd);
+  buf[n] = 0;
+
+  cap = 0;
+  for(s = buf; *s; s++)
+    if(*s == '\n')
+      cap++;
+  if((t->syms = malloc((cap + 1) * sizeof(struct sym))) == 0)
+    return;
+  for(s = buf; *s; s = e){
+    for(e = s; *e && *e != '\n'; e++)
+      ;
+    if(*e)
+      *e++ = 0;
+    uint64 addr = hex(&s);
+    if(*s != ' ' || notfunc(s + 1))
+      continue;
+    // insertion sort: files are mostly sorted already
+    int i = t->n++;
+    while(i > 0 && t->syms[i-1].addr > addr){
+      t->syms[i] = t->syms[i-1];
+      i--;
+    }
+    t->syms[i].addr = addr;
+    t->syms[i].name = s + 1;
+    t->syms[i].hits = 0;
+  }
+}
+
+static struct symtab*
+symtab(char *name)
+{
+  for(int i = 0; i < ntabs; i++)
+    if(strcmp(tabs[i].name, name) == 0)
+      return &tabs[i];
+  if(ntabs == NTAB)
+    return 0;
+  loadsyms(&tabs[ntabs], name);
+  return &tabs[ntabs++];
+}
+
+// Charge one sample at pc to the function of t that contains it.
+static void
+hit(struct symtab *t, uint64 pc)
+{
+  int lo = 0, hi = t->n - 1, found = -1;
+
+  while(lo <= hi){
+    int mid = (lo + hi) / 2;
+    if(t->syms[mid].addr <= pc){
+      found = mid;
+      lo = mid + 1;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  if(found < 0)
+    t->unknown++;
+  else
+    t->syms[found].hits++;
+}
+
+// Print count as a percentage of total, with one decimal.
+static void
+pct(int count, int total)
+{
+  int tenths = total ? (count * 1000 + total/2) / total : 0;
+  if(tenths < 1000)
+    printf(" ");
+  if(tenths < 100)
+    printf(" ");
+  printf("%d.%d%%", tenths / 10, tenths % 10);
+}
+
+static void
+report(int ntop, int dropped)
+{
+  struct prof_sample *s;
+  int n, nuser = 0, nidle = 0;
+
+  if((s = malloc(MAXSAMPLES * sizeof(*s))) == 0){
+    fprintf(2, "prof: out of memory\n");
+    exit(1);
+  }
+  if((n = profread(s, MAXSAMPLES)) < 0){
+    fprintf(2, "prof: profread failed\n");
+    exit(1);
+  }
+
+  symtab("kernel");
+  for(int i = 0; i < n; i++){
+    struct symtab *t = &tabs[0];
+    if(s[i].flags & PROF_USER){
+      nuser++;
+      if((t = symtab(s[i].name)) == 0){
+        continue;
+      }
+    } else if(s[i].pid == 0){
+      nidle++;
+    }
+    hit(t, s[i].pc);
+  }
+
+  printf("%d samples: %d user, %d kernel (%d idle)", n, nuser, n - nuser, nidle);
+  if(dropped > 0)
+    printf(", %d dropped", dropped);
+  printf("\n");
+  if(n == 0)
+    return;
+  printf("     %%  samples  function\n");
+  for(int k = 0; k < ntop; k++){
+    struct symtab *bt = 0;
+    int best = -1, most = 0;
+    for(int i = 0; i < ntabs; i++)
+      for(int j = 0; j < tabs[i].n; j++)
+        if(tabs[i].syms[j].hits > most){
+          most = tabs[i].syms[j].hits;
+          bt = &tabs[i];
+          best = j;
+        }
+    if(best < 0)
+      break;
+    pct(most, n);
+    printf("  %d\t%s:%s\n", most, bt->name, bt->syms[best].name);
+    bt->syms[best].hits = 0;
+  }
+  for(int i = 0; i < ntabs; i++)
+    if(tabs[i].unknown > 0){
+      pct(tabs[i].unknown, n);
+      printf("  %d\t%s:?\n", tabs[i].unknown, tabs[i].name);
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+  if(argc < 2){
+    fprintf(2, "usage: prof start | stop | report [n] | cmd [arg ...]\n");
+    exit(1);
+  }
+
+  if(strcmp(argv[1], "start") == 0){
+    profstart();
+  } else if(strcmp(argv[1], "stop") == 0){
+    int dropped = profstop();
+    if(dropped > 0)
+      printf("prof: %d samples dropped\n", dropped);
+  } else if(strcmp(argv[1], "report") == 0){
+    report(argc > 2 ? atoi(argv[2]) : NTOP, 0);
+  } else {
+    profstart();
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "prof: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      fprintf(2, "prof: exec %s failed\n", argv[1]);
+      exit(1);
+    }
+    wait(0);
+    report(NTOP, profstop());
+  }
+  exit(0);
+}
+
+//############## LLM Generated Code Ends ################
@@ -0,0 +1,70 @@
+//############## LLM Generated Code Begins ##############
+
+// schedstat [interval [count]]: MLFQ scheduling state of every
+// process: level, ticks used of the current quantum, CPU time,
+// dispatches and demotions for heavy faulting. With an interval
+// (in ticks), prints the table every interval ticks, count times
+// or forever.
+
+#include "kernel/types.h"
+#include "user/user.h"
+#include "kernel/memstat.h"
+
+#define MAXPROC      64
+// r_time() ticks per millisecond (QEMU's timebase is 10 MHz).
+#define TICKS_PER_MS 10000
+
+static struct sched_info si[MAXPROC];
+
+static char *states[] = {
+  [2] "sleep",
+  [3] "runble",
+  [4] "run",
+  [5] "zombie",
+};
+
+static void
+show(void)
+{
+  int n;
+
+  if((n = schedinfo(si, MAXPROC)) < 0){
+    fprintf(2, "schedstat: schedinfo failed\n");
+    exit(1);
+  }
+  printf("pid\tlvl\tslice\tcpu_ms\truns\tfdemote\tstate\tname\n");
+  for(int i = 0; i < n; i++){
+    struct sched_info *s = &si[i];
+    char *st = s->state >= 2 && s->state <= 5 ? states[s->state] : "?";
+    printf("%d\t%d\t%d\t%ld\t%ld\t%ld\t%s\t%s\n", s->pid, s->priority,
+           s->slice, s->cputime / TICKS_PER_MS, s->nsched,
+           s->nfault_demote, st, s->name);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int interval = 0, count = -1;
+
+  if(argc > 3){
+    fprintf(2, "usage: schedstat [interval [count]]\n");
+    exit(1);
+  }
+  if(argc >= 2)
+    interval = atoi(argv[1]);
+  if(argc == 3)
+    count = atoi(argv[2]);
+
+  show();
+  if(interval <= 0)
+    exit(0);
+  for(int i = 1; count < 0 || i < count; i++){
+    pause(interval);
+    printf("\n");
+    show();
+  }
+  exit(0);
+}
+
+//############## LLM Generated Code Ends ################
@@ -0,0 +1,78 @@
+//############## LLM Generated Code Begins ##############
+
+#include "kernel/types.h"
+#include "user.h"
+#include "kernel/memstat.h"
+
+#define NPAGES 300   // more than memstat()'s MAX_PAGES_INFO
+#define CAP    16    // small buffer, so the cursor is exercised
+
+void test_memstat2() {
+    printf("[TEST] Starting memstat2 Test\n");
+
+    struct page_stat2 buf[CAP];
+    struct proc_vm_stat st;
+
+    printf("[INFO] Allocating and touching %d pages...\n", NPAGES);
+    char *mem = sbrk(NPAGES * 4096);
+    if (mem == (char*)-1) {
+        printf("[ERROR] sbrk failed\n");
+        exit(1);
+    }
+    for (int i = 0; i < NPAGES; i++)
+        mem[i * 4096] = i;
+
+    // Page through the whole address space
+    int total = 0, calls = 0, sorted = 1;
+    uint64 last = 0, cursor = 0;
+    uint64 end = 0;
+    while (1) {
+        uint64 next = memstat2(cursor, buf, CAP, &st);
+        if (next == (uint64)-1) {
+            printf("[ERROR] memstat2 failed\n");
+            exit(1);
+        }
+        calls++;
+        for (int i = 0; i < st.npages; i++) {
+            if ((total > 0 || i > 0) && buf[i].va <= last)
+                sorted = 0;
+            last = buf[i].va;
+            total++;
+        }
+        if (st.npages < CAP) {
+            end = next;
+            break;
+        }
+        cursor = next;
+    }
+
+    printf("[INFO] %d pages reported in %d calls, cursor ended at 0x%lx\n",
+           total, calls, end);
+
+    if (total >= NPAGES && sorted) {
+        printf("[PASS] All touched pages reported in address order\n");
+    } else {
+        printf("[FAIL] Expected at least %d sorted pages, got %d (sorted=%d)\n",
+               NPAGES, total, sorted);
+    }
+
+    printf("[INFO] faults heap=%ld stack=%ld exec=%ld swap=%ld swapins=%ld swapouts=%ld\n",
+           st.faults[FAULT_HEAP], st.faults[FAULT_STACK], st.faults[FAULT_EXEC],
+           st.faults[FAULT_SWAP], st.swapins, st.swapouts);
+    printf("[INFO] exec_bytes=%ld evictions=%ld fault_time=%ld\n",
+           st.exec_bytes, st.evictions, st.fault_time);
+
+    if (st.faults[FAULT_HEAP] >= NPAGES && st.exec_bytes > 0) {
+        printf("[PASS] Fault and exec counters account for the touched pages\n");
+    } else {
+        printf("[FAIL] Counters too low: heap faults=%ld exec_bytes=%ld\n",
+               st.faults[FAULT_HEAP], st.exec_bytes);
+    }
+}
+
+int main() {
+    test_memstat2();
+    exit(0);
+}
+
+//############## LLM Generated Code Ends ################
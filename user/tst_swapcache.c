@@ -0,0 +1,82 @@
+//############## LLM Generated Code Begins ##############
+
+#include "kernel/types.h"
+#include "user.h"
+#include "kernel/memstat.h"
+
+#define PGSIZE 4096
+#define NBYTES 512   // fits in a pipe buffer
+
+// Make every page of mem[0..n) dirty, in order. FIFO replacement
+// with more pages than memory evicts each page before its next turn.
+static void
+sweep(char *mem, int first, int n, char c)
+{
+    for (int i = first; i < n; i++)
+        mem[i * PGSIZE] = c;
+}
+
+void test_swapcache() {
+    printf("[TEST] Starting Swap-Cache Test\n");
+
+    struct vm_stat vs;
+    struct page_stat2 ps;
+    struct proc_vm_stat st;
+    char buf[NBYTES];
+    int fds[2];
+
+    if (vmstat(&vs) < 0) {
+        printf("[ERROR] vmstat failed\n");
+        exit(1);
+    }
+    // Larger than memory, so that page 0 is evicted by each sweep.
+    int n = vs.free_frames + vs.free_frames / 4;
+    printf("[INFO] Sweeping %d pages (%ld frames free)...\n", n, vs.free_frames);
+    char *mem = sbrk(n * PGSIZE);
+    if (mem == (char*)-1) {
+        printf("[ERROR] sbrk failed\n");
+        exit(1);
+    }
+    sweep(mem, 0, n, 'A');
+
+    // Read page 0 back: it comes in clean and keeps its swap slot.
+    if (mem[0] != 'A') {
+        printf("[FAIL] Page 0 lost its first contents\n");
+        exit(1);
+    }
+    if (memstat2((uint64)mem, &ps, 1, &st) == (uint64)-1 || st.npages < 1 ||
+        ps.va != ((uint64)mem & ~(PGSIZE - 1)) || ps.swap_slot < 0 || ps.is_dirty) {
+        printf("[FAIL] Page 0 is not a clean swap-cache page\n");
+        exit(1);
+    }
+    printf("[INFO] Page 0 swapped in, swap-cache slot %d\n", ps.swap_slot);
+
+    // Fill it through read(): the kernel writes the page, not the user.
+    memset(buf, 'Z', NBYTES);
+    if (pipe(fds) < 0 || write(fds[1], buf, NBYTES) != NBYTES ||
+        read(fds[0], mem, NBYTES) != NBYTES) {
+        printf("[ERROR] pipe I/O failed\n");
+        exit(1);
+    }
+    close(fds[0]);
+    close(fds[1]);
+
+    // Evict it again, then check what comes back.
+    printf("[INFO] Sweeping again to evict page 0...\n");
+    sweep(mem, 1, n, 'B');
+    for (int i = 0; i < NBYTES; i++) {
+        if (mem[i] != 'Z') {
+            printf("[FAIL] Byte %d of page 0 is '%c' after eviction, expected 'Z'\n",
+                   i, mem[i]);
+            exit(1);
+        }
+    }
+    printf("[PASS] Data read() into a swap-cache page survived eviction\n");
+}
+
+int main() {
+    test_swapcache();
+    exit(0);
+}
+
+//############## LLM Generated Code Ends ################
@@ -27,6 +27,17 @@ char* sys_sbrk(int,int);
 int pause(int);
 int uptime(void);
 int memstat(struct proc_mem_stat*);
+int thrashstat(struct thrash_stat*);
+uint64 memstat2(uint64, struct page_stat2*, int, struct proc_vm_stat*);
+int faultstat(int, struct fault_stat*);
+int vmstat(struct vm_stat*);
+int profstart(void);
+int profstop(void);
+int profread(struct prof_sample*, int);
+int lockstat(struct lock_stat*, int);
+int pgtrace(int, int);
+int pgtraceread(struct pgtrace_rec*, int);
+int schedinfo(struct sched_info*, int);
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -43,3 +43,14 @@ entry("sbrk");
 entry("pause");
 entry("uptime");
 entry("memstat");
+entry("thrashstat");
+entry("memstat2");
+entry("faultstat");
+entry("vmstat");
+entry("profstart");
+entry("profstop");
+entry("profread");
+entry("lockstat");
+entry("pgtrace");
+entry("pgtraceread");
+entry("schedinfo");
@@ -0,0 +1,108 @@
+//############## LLM Generated Code Begins ##############
+
+// vmstat [interval [count]]: system-wide memory statistics.
+// Without arguments, prints one line of totals since boot. With an
+// interval (in ticks), prints the memory state and the events of
+// the last interval every interval ticks, count times or forever.
+
+#include "kernel/types.h"
+#include "user/user.h"
+#include "kernel/memstat.h"
+
+static void
+header(void)
+{
+  printf("  free   res  swap |  flt mfull  scan evict    si    so  psw |  bhit bmiss    dr    dw |    ra  rhit rmiss\n");
+}
+
+// Print n right-aligned in a field of width w.
+static void
+col(uint64 n, int w)
+{
+  char buf[24];
+  int i = sizeof(buf) - 1;
+
+  buf[i] = 0;
+  do {
+    buf[--i] = '0' + n % 10;
+    n /= 10;
+  } while(n && i > 0);
+  for(int len = sizeof(buf) - 1 - i; len < w; len++)
+    printf(" ");
+  printf("%s", buf + i);
+}
+
+// One line: current state of cur, and events between old and cur.
+static void
+line(struct vm_stat *old, struct vm_stat *cur)
+{
+  uint64 d[NVMSTAT];
+
+  for(int i = 0; i < NVMSTAT; i++)
+    d[i] = cur->count[i] - old->count[i];
+  col(cur->free_frames, 6);
+  col(cur->resident_pages, 6);
+  col(cur->swap_slots, 6);
+  printf(" |");
+  col(d[VM_PGFAULT], 5);
+  col(d[VM_MEMFULL], 6);
+  col(d[VM_SCAN], 6);
+  col(d[VM_EVICT], 6);
+  col(d[VM_SWAPIN], 6);
+  col(d[VM_SWAPOUT], 6);
+  col(d[VM_PROCSWAPOUT], 5);
+  printf(" |");
+  col(d[VM_BCACHE_HIT], 6);
+  col(d[VM_BCACHE_MISS], 6);
+  col(d[VM_DISK_READ], 6);
+  col(d[VM_DISK_WRITE], 6);
+  printf(" |");
+  col(d[VM_READAHEAD], 6);
+  col(d[VM_RA_HIT], 6);
+  col(d[VM_RA_MISS], 6);
+  printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct vm_stat old, cur;
+  int interval = 0, count = -1;
+
+  if(argc > 3){
+    fprintf(2, "usage: vmstat [interval [count]]\n");
+    exit(1);
+  }
+  if(argc > 1 && (interval = atoi(argv[1])) <= 0){
+    fprintf(2, "vmstat: bad interval %s\n", argv[1]);
+    exit(1);
+  }
+  if(argc > 2)
+    count = atoi(argv[2]);
+
+  if(vmstat(&cur) < 0){
+    fprintf(2, "vmstat: vmstat failed\n");
+    exit(1);
+  }
+  printf("%ld frames, %ld ticks since boot\n", cur.total_frames, cur.ticks);
+  header();
+  memset(&old, 0, sizeof(old));
+  line(&old, &cur);
+  if(interval == 0)
+    exit(0);
+
+  for(int n = 1; count < 0 || n < count; n++){
+    old = cur;
+    pause(interval);
+    if(vmstat(&cur) < 0){
+      fprintf(2, "vmstat: vmstat failed\n");
+      exit(1);
+    }
+    if(n % 20 == 0)
+      header();
+    line(&old, &cur);
+  }
+  exit(0);
+}
+
+//############## LLM Generated Code Ends ################